@@ -29,270 +29,644 @@
 #include <topologic/version.h>
 
 namespace topologic {
-/**\brief Parse command line arguments
+/**\brief Command line argument parser
  *
- * A function template to parse C-style command line arguments, apply the
- * settings in those arguments to a topologic::state instance. This
- * function will also parse XML files that have been passed in as command
- * line arguments and set the model in the state object to match that
- * specified as command line arguments or in XML files.
+ * Holds the set of command line options that topologic understands, applied
+ * to a topologic::state instance. The options are compiled when an instance
+ * of this class is created, so a single instance can be used to apply any
+ * number of argument vectors without having to recompile the regular
+ * expressions that the options are matched against each time. The same goes
+ * for the XML parser library, which is only initialised once per instance.
  *
  * As usual, later options override earlier ones - that also applies to
  * settings in XML files. If the NOLIBRARIES macro is set then XML files
  * will not be processed.
  *
+ * \note Options are registered with efgy::cli::options<>::common(), so there
+ *       should only ever be one instance of this class at a time.
+ *
  * \tparam Q   Base data type as used in the topologic::state instance
  * \tparam dim Maximum render depth of the topologic::state instance
- *
- * \param[out] topologicState The topologic::state instance to populate
- * \param[in]  args           Command line argument vector.
- * \param[in]  readFiles      Try to treat unrecognised options as files.
- *
- * \returns The output mode set in the argument vector. Defaults to outNone.
  */
-template <typename Q, std::size_t dim>
-enum outputMode parse(state<Q, dim> &topologicState,
-                      const std::vector<std::string> &args,
-                      bool readFiles = true) {
-  enum outputMode out = outNone;
+template <typename Q, std::size_t dim> class arguments {
+public:
+  /**\brief Construct with state object
+   *
+   * Compiles all the command line options and binds them to the given
+   * topologic::state instance.
+   *
+   * \param[out] pState The topologic::state instance to populate.
+   */
+  arguments(state<Q, dim> &pState)
+      : topologicState(&pState), out(outNone), depth(4), rdepth(4),
+        model("cube"), format("cartesian"),
+        oversion("-{0,2}version", [](std::smatch &)->bool {
+          std::cout << "Topologic/V" << version << "\n"
+                                                   "libefgy/V" << efgy::version
+                    << "\n"
+                       "Maximum render depth of this binary is " << dim
+                    << " dimensions.\n";
+          if (MINDEPTH > 0) {
+            std::cout << "Minimum render depth of this binary is " << MINDEPTH
+                      << " dimensions.\n";
+          }
+          std::cout << "Supported models:";
+          std::set<const char *> models;
+          for (const char *m :
+               efgy::geometry::with<Q, efgy::geometry::functor::models, dim>(
+                   models, "*", 0, 0)) {
+            if (profile::model(m)) {
+              std::cout << " " << m;
+            }
+          }
+          std::cout << "\n"
+                       "Supported vector coordinate formats:";
+          std::set<const char *> formats;
+          for (const char *f :
+               efgy::geometry::with<Q, efgy::geometry::functor::formats, dim>(
+                   formats, "*", "*", 0, 0)) {
+            if (profile::format(f)) {
+              std::cout << " " << f;
+            }
+          }
+          std::cout << "\n"
+                       "Supported numbers: double"
+                    << (profile::floats() ? " float mixed" : " mixed") << "\n";
+          return true;
+        },
+                 "Print version information."),
+        omodel(
+            "-{0,2}m(odel)?:([0-9]+)-([a-z-]+)(@([0-9]+))?(:([a-z]+))?",
+            [this](std::smatch & m)->bool {
+              depth = std::stoi(m[2]);
+              model = m[3];
+              if (m[5] != "") {
+                rdepth = std::stoi(m[5]);
+              }
+              if (m[7] != "") {
+                format = m[7];
+              }
+              return true;
+            },
+            "Sets all the model type parameters. The form is: "
+            "D-MODEL[@R][:FORMAT], e.g. 3-cube@4:polar. The default is "
+            "4-cube@4:cartesian."),
+        oformat("-{0,2}(none|json|svg|svg:stream|arguments|mesh|mesh:full|"
+                "ppm|png|points|points:full)",
+                [this](std::smatch & m)->bool {
+                  if (m[1] == "json") {
+                    out = topologic::outJSON;
+                  } else if (m[1] == "svg") {
+                    out = topologic::outSVG;
+                  } else if (m[1] == "svg:stream") {
+                    out = topologic::outSVGStream;
+                  } else if (m[1] == "arguments") {
+                    out = topologic::outArguments;
+                  } else if (m[1] == "mesh") {
+                    out = topologic::outMesh;
+                  } else if (m[1] == "mesh:full") {
+                    out = topologic::outMeshFull;
+                  } else if (m[1] == "ppm") {
+                    out = topologic::outPPM;
+                  } else if (m[1] == "png") {
+                    out = topologic::outPNG;
+                  } else if (m[1] == "points") {
+                    out = topologic::outPoints;
+                  } else if (m[1] == "points:full") {
+                    out = topologic::outPointsFull;
+                  } else {
+                    out = topologic::outNone;
+                  }
+                  return true;
+                },
+                "Select an output format."),
+        oifs(
+            "-{0,2}r(andom)?:([0-9]+)(:([0-9]+))?(:([0-9]+))?(:pre)?(:post)?",
+            [this](std::smatch & m)->bool {
+              topologicState->state<Q, 2>::parameter.seed = Q(std::stold(m[2]));
+              if (m[4] != "") {
+                topologicState->state<Q, 2>::parameter.functions =
+                    Q(std::stold(m[4]));
+              }
+              if (m[6] != "") {
+                topologicState->state<Q, 2>::parameter.flameCoefficients =
+                    Q(std::stold(m[6]));
+              }
+              topologicState->state<Q, 2>::parameter.preRotate =
+                  (m[7] == ":pre");
+              topologicState->state<Q, 2>::parameter.postRotate =
+                  (m[8] == ":post");
+              return true;
+            },
+            "Set parameters for randomised models. The order of the arguments "
+            "is: seed[:functions][:variants][:pre][:post]. Only the seed is "
+            "required to be set."),
+        ocolour(
+            "-{0,2}colour(:fractal-flame|"
+            "(:b:([0-9.]+):([0-9.]+):([0-9.]+):([0-9.]+))?"
+            "(:w:([0-9.]+):([0-9.]+):([0-9.]+):([0-9.]+))?"
+            "(:s:([0-9.]+):([0-9.]+):([0-9.]+):([0-9.]+))?)",
+            [this](std::smatch & m)->bool {
+              topologicState->state<Q, 2>::fractalFlameColouring =
+                  (m[1] == ":fractal-flame");
+              if (m[2] != "") {
+                topologicState->state<Q, 2>::background.red =
+                    Q(std::stold(m[3]));
+                topologicState->state<Q, 2>::background.green =
+                    Q(std::stold(m[4]));
+                topologicState->state<Q, 2>::background.blue =
+                    Q(std::stold(m[5]));
+                topologicState->state<Q, 2>::background.alpha =
+                    Q(std::stold(m[6]));
+              }
+              if (m[7] != "") {
+                topologicState->state<Q, 2>::wireframe.red =
+                    Q(std::stold(m[8]));
+                topologicState->state<Q, 2>::wireframe.green =
+                    Q(std::stold(m[9]));
+                topologicState->state<Q, 2>::wireframe.blue =
+                    Q(std::stold(m[10]));
+                topologicState->state<Q, 2>::wireframe.alpha =
+                    Q(std::stold(m[11]));
+              }
+              if (m[12] != "") {
+                topologicState->state<Q, 2>::surface.red = Q(std::stold(m[13]));
+                topologicState->state<Q, 2>::surface.green =
+                    Q(std::stold(m[14]));
+                topologicState->state<Q, 2>::surface.blue =
+                    Q(std::stold(m[15]));
+                topologicState->state<Q, 2>::surface.alpha =
+                    Q(std::stold(m[16]));
+              }
+              return true;
+            },
+            "Set the colour scheme to use."),
+        oradius("-{0,2}(R|radius):([0-9.]+)(:([0-9.]+))?",
+                [this](std::smatch & m)->bool {
+                  topologicState->state<Q, 2>::parameter.radius =
+                      Q(std::stold(m[2]));
+                  if (m[4] != "") {
+                    topologicState->state<Q, 2>::parameter.radius2 =
+                        Q(std::stold(m[4]));
+                  }
+                  return true;
+                },
+                "Set the radii used in some formulas."),
+        oparam(
+            "-{0,2}(p|precision|c|constant):([0-9.]+)",
+            [this](std::smatch & m)->bool {
+              if ((m[1] == "precision") || (m[1] == "p")) {
+                topologicState->state<Q, 2>::parameter.precision =
+                    Q(std::stold(m[2]));
+              } else if ((m[1] == "constant") || (m[1] == "c")) {
+                topologicState->state<Q, 2>::parameter.constant =
+                    Q(std::stold(m[2]));
+              }
+              return true;
+            },
+            "Set the precision, or the constant factor for some formulae."),
+        oiterations("-{0,2}(i|iterations):([0-9]+)",
+                    [this](std::smatch & m)->bool {
+                      topologicState->state<Q, 2>::parameter.iterations =
+                          Q(std::stoll(m[2]));
+                      return true;
+                    },
+                    "Set the number of iterations for iterative formulae."),
+        ofrom(
+            "-{0,2}f(rom)?((:[0-9.]+){2,})(:polar)?",
+            [this](std::smatch & m)->bool {
+              topologicState->state<Q, 2>::polarCoordinates =
+                  (m[4] == ":polar");
+              std::istringstream s(m[2]);
+              std::string coord;
+              std::vector<Q> v;
 
-#if !defined(NOLIBRARIES)
-  topologic::xml XML;
-#endif
-  std::size_t depth = 4, rdepth = 4;
-  std::string model = "cube";
-  std::string format = "cartesian";
-
-  efgy::cli::option oversion("-{0,2}version", [](std::smatch &)->bool {
-    std::cout << "Topologic/V" << version << "\n"
-                                             "libefgy/V" << efgy::version
-              << "\n"
-                 "Maximum render depth of this binary is " << dim
-              << " dimensions.\n"
-                 "Supported models:";
-    std::set<const char *> models;
-    for (const char *m :
-         efgy::geometry::with<Q, efgy::geometry::functor::models, dim>(
-             models, "*", 0, 0)) {
-      std::cout << " " << m;
-    }
-    std::cout << "\n"
-                 "Supported vector coordinate formats:";
-    std::set<const char *> formats;
-    for (const char *f :
-         efgy::geometry::with<Q, efgy::geometry::functor::formats, dim>(
-             formats, "*", "*", 0, 0)) {
-      std::cout << " " << f;
-    }
-    std::cout << "\n";
-    return true;
-  },
-                             "Print version information.");
-
-  efgy::cli::option omodel(
-      "-{0,2}m(odel)?:([0-9]+)-([a-z-]+)(@([0-9]+))?(:([a-z]+))?",
-      [&depth, &rdepth, &model, &format](std::smatch & m)->bool {
-    depth = std::stoi(m[2]);
-    model = m[3];
-    if (m[5] != "") {
-      rdepth = std::stoi(m[5]);
-    }
-    if (m[7] != "") {
-      format = m[7];
-    }
-    return true;
-  },
-      "Sets all the model type parameters. The form is: D-MODEL[@R][:FORMAT], "
-      "e.g. 3-cube@4:polar. The default is 4-cube@4:cartesian.");
-
-  efgy::cli::option oformat("-{0,2}(none|json|svg|arguments)",
-                            [&out](std::smatch & m)->bool {
-    if (m[1] == "json") {
-      out = topologic::outJSON;
-    } else if (m[1] == "svg") {
-      out = topologic::outSVG;
-    } else if (m[1] == "arguments") {
-      out = topologic::outArguments;
-    } else {
-      out = topologic::outNone;
-    }
-    return true;
-  },
-                            "Select an output format.");
-
-  efgy::cli::option oifs(
-      "-{0,2}r(andom)?:([0-9]+)(:([0-9]+))?(:([0-9]+))?(:pre)?(:post)?",
-      [&topologicState](std::smatch & m)->bool {
-    topologicState.state<Q, 2>::parameter.seed = Q(std::stold(m[2]));
-    if (m[4] != "") {
-      topologicState.state<Q, 2>::parameter.functions = Q(std::stold(m[4]));
-    }
-    if (m[6] != "") {
-      topologicState.state<Q, 2>::parameter.flameCoefficients =
-          Q(std::stold(m[6]));
-    }
-    topologicState.state<Q, 2>::parameter.preRotate = (m[7] == ":pre");
-    topologicState.state<Q, 2>::parameter.postRotate = (m[8] == ":post");
-    return true;
-  },
-      "Set parameters for randomised models. The order of the arguments is: "
-      "seed[:functions][:variants][:pre][:post]. Only the seed is required to "
-      "be set.");
-
-  efgy::cli::option ocolour("-{0,2}colour(:fractal-flame|"
-                            "(:b:([0-9.]+):([0-9.]+):([0-9.]+):([0-9.]+))?"
-                            "(:w:([0-9.]+):([0-9.]+):([0-9.]+):([0-9.]+))?"
-                            "(:s:([0-9.]+):([0-9.]+):([0-9.]+):([0-9.]+))?)",
-                            [&topologicState](std::smatch & m)->bool {
-    topologicState.state<Q, 2>::fractalFlameColouring =
-        (m[1] == ":fractal-flame");
-    if (m[2] != "") {
-      topologicState.state<Q, 2>::background.red = Q(std::stold(m[3]));
-      topologicState.state<Q, 2>::background.green = Q(std::stold(m[4]));
-      topologicState.state<Q, 2>::background.blue = Q(std::stold(m[5]));
-      topologicState.state<Q, 2>::background.alpha = Q(std::stold(m[6]));
-    }
-    if (m[7] != "") {
-      topologicState.state<Q, 2>::wireframe.red = Q(std::stold(m[8]));
-      topologicState.state<Q, 2>::wireframe.green = Q(std::stold(m[9]));
-      topologicState.state<Q, 2>::wireframe.blue = Q(std::stold(m[10]));
-      topologicState.state<Q, 2>::wireframe.alpha = Q(std::stold(m[11]));
-    }
-    if (m[12] != "") {
-      topologicState.state<Q, 2>::surface.red = Q(std::stold(m[13]));
-      topologicState.state<Q, 2>::surface.green = Q(std::stold(m[14]));
-      topologicState.state<Q, 2>::surface.blue = Q(std::stold(m[15]));
-      topologicState.state<Q, 2>::surface.alpha = Q(std::stold(m[16]));
-    }
-    return true;
-  },
-                            "Set the colour scheme to use.");
-
-  efgy::cli::option oradius("-{0,2}(R|radius):([0-9.]+)(:([0-9.]+))?",
-                            [&topologicState](std::smatch & m)->bool {
-    topologicState.state<Q, 2>::parameter.radius = Q(std::stold(m[2]));
-    if (m[4] != "") {
-      topologicState.state<Q, 2>::parameter.radius2 = Q(std::stold(m[4]));
-    }
-    return true;
-  },
-                            "Set the radii used in some formulas.");
-
-  efgy::cli::option oparam(
-      "-{0,2}(p|precision|c|constant):([0-9.]+)",
-      [&topologicState](std::smatch & m)->bool {
-    if ((m[1] == "precision") || (m[1] == "p")) {
-      topologicState.state<Q, 2>::parameter.precision = Q(std::stold(m[2]));
-    } else if ((m[1] == "constant") || (m[1] == "c")) {
-      topologicState.state<Q, 2>::parameter.constant = Q(std::stold(m[2]));
-    }
-    return true;
-  },
-      "Set the precision, or the constant factor for some formulae.");
+              while (std::getline(s, coord, ':')) {
+                if (coord != "") {
+                  v.push_back(Q(std::stold(coord)));
+                }
+              }
 
-  efgy::cli::option oiterations(
-      "-{0,2}(i|iterations):([0-9]+)",
-      [&topologicState](std::smatch & m)->bool {
-    topologicState.state<Q, 2>::parameter.iterations = Q(std::stoll(m[2]));
-    return true;
-  },
-      "Set the number of iterations for iterative formulae.");
-
-  efgy::cli::option ofrom(
-      "-{0,2}f(rom)?((:[0-9.]+){2,})(:polar)?",
-      [&topologicState](std::smatch & m)->bool {
-    topologicState.state<Q, 2>::polarCoordinates = (m[4] == ":polar");
-    std::istringstream s(m[2]);
-    std::string coord;
-    std::vector<Q> v;
-
-    while (std::getline(s, coord, ':')) {
-      if (coord != "") {
-        v.push_back(Q(std::stold(coord)));
-      }
-    }
+              for (std::size_t i = 0; i < v.size(); i++) {
+                topologicState->setFromCoordinate(i, v[i], v.size());
+              }
 
-    for (std::size_t i = 0; i < v.size(); i++) {
-      topologicState.setFromCoordinate(i, v[i], v.size());
-    }
+              return true;
+            },
+            "Set a from point of the transformation. Which of the from points "
+            "is set depends on the number of coordinates given. The polar "
+            "suffix treats the input as polar coordinates."),
+        otransform(
+            "-{0,2}t(ransform)?((:[0-9.]+){2,})",
+            [this](std::smatch & m)->bool {
+              std::istringstream s(m[2]);
+              std::string coord;
+              std::vector<Q> v;
 
-    return true;
-  },
-      "Set a from point of the transformation. Which of the from points is set "
-      "depends on the number of coordinates given. The polar suffix treats the "
-      "input as polar coordinates.");
-
-  efgy::cli::option otransform(
-      "-{0,2}t(ransform)?((:[0-9.]+){2,})",
-      [&topologicState](std::smatch & m)->bool {
-    std::istringstream s(m[2]);
-    std::string coord;
-    std::vector<Q> v;
-
-    while (std::getline(s, coord, ':')) {
-      if (coord != "") {
-        v.push_back(Q(std::stold(coord)));
-      }
-    }
+              while (std::getline(s, coord, ':')) {
+                if (coord != "") {
+                  v.push_back(Q(std::stold(coord)));
+                }
+              }
 
-    const std::size_t d = std::sqrt(v.size());
-    if (v.size() != (d * d)) {
-      return false;
-    }
+              const std::size_t d = std::sqrt(v.size());
+              if (v.size() != (d * d)) {
+                return false;
+              }
+
+              for (std::size_t i = 0, x = 0; x < d; x++) {
+                for (std::size_t y = 0; y < d; y++) {
+                  setMatrixCell(*topologicState, d - 1, x, y, v[i]);
+                  i++;
+                }
+              }
+
+              return true;
+            },
+            "Set a tranformation matrix. Which of the matrices is set depends "
+            "on the number of coordinates given."),
+        oprojection("-{0,2}(orthographic|perspective)(:([0-9]+))?",
+                    [this](std::smatch & m)->bool {
+                      const std::size_t d =
+                          m[3] != "" ? std::stoul(m[3]) : 0;
+                      return topologicState->setOrthographic(
+                          m[1] == "orthographic", d);
+                    },
+                    "Use an orthographic or perspective projection from the "
+                    "given dimension, or from all of them. The default is "
+                    "perspective."),
+        ocacheDirectory("-{0,2}cache-dir:(.+)", [this](std::smatch & m)->bool {
+          topologicState->state<Q, 2>::cacheDirectory = m[1];
+          return true;
+        },
+                        "Cache generated model geometry in the given "
+                        "directory."),
+        ocacheSize("-{0,2}cache-size:([0-9]+)([kMG]?)",
+                   [this](std::smatch & m)->bool {
+                     std::size_t size = std::stoull(m[1]);
+                     if (m[2] == "k") {
+                       size <<= 10;
+                     } else if (m[2] == "M") {
+                       size <<= 20;
+                     } else if (m[2] == "G") {
+                       size <<= 30;
+                     }
+                     topologicState->state<Q, 2>::cacheSize = size;
+                     return true;
+                   },
+                   "Set the maximum size of the geometry cache directory, in "
+                   "bytes; use a k, M or G suffix for larger units. The "
+                   "default is 256M."),
+        omaxMemory("-{0,2}max-memory:([0-9]+)([kMG]?)",
+                   [this](std::smatch & m)->bool {
+                     std::size_t size = std::stoull(m[1]);
+                     if (m[2] == "k") {
+                       size <<= 10;
+                     } else if (m[2] == "M") {
+                       size <<= 20;
+                     } else if (m[2] == "G") {
+                       size <<= 30;
+                     }
+                     topologicState->state<Q, 2>::maxMemory = size;
+                     return true;
+                   },
+                   "Set the maximum size of the geometry kept in memory, in "
+                   "bytes; use a k, M or G suffix for larger units. The "
+                   "default is 0, for no limit."),
+        olod("-{0,2}lod:([0-9]*\\.?[0-9]+([eE]-?[0-9]+)?)",
+             [this](std::smatch & m)->bool {
+               topologicState->state<Q, 2>::lodTolerance = Q(std::stold(m[1]));
+               return true;
+             },
+             "Stop iterating parts of IFS models once they are smaller than "
+             "the given size, in SVG units. The default is 0, to always "
+             "iterate."),
+        osamples("-{0,2}samples:([0-9]+)", [this](std::smatch & m)->bool {
+          topologicState->state<Q, 2>::samples = std::stoull(m[1]);
+          return true;
+        },
+                 "Play the chaos game with the given number of samples for "
+                 "point clouds and IFS raster images."),
+        odedup("-{0,2}dedup:([0-9]*\\.?[0-9]+([eE]-?[0-9]+)?)",
+               [this](std::smatch & m)->bool {
+                 topologicState->state<Q, 2>::duplicateTolerance =
+                     Q(std::stold(m[1]));
+                 return true;
+               },
+               "Remove faces that are the same as an earlier face, with "
+               "coordinates rounded to multiples of the given tolerance. Use "
+               "stats to see how many were removed."),
+        osize("-{0,2}size:([0-9]+)x([0-9]+)", [this](std::smatch & m)->bool {
+          std::size_t w = std::stoul(m[1]), h = std::stoul(m[2]);
+          if ((w == 0) || (h == 0)) {
+            std::cerr << "error: image size must not be empty\n";
+            return false;
+          }
+          topologicState->state<Q, 2>::rasterWidth = w;
+          topologicState->state<Q, 2>::rasterHeight = h;
+          return true;
+        },
+              "Set the size of raster images, in pixels. The default is "
+              "512x512."),
+        ostats("-{0,2}stats(:metadata)?", [this](std::smatch & m)->bool {
+          topologicState->statistics.enabled = true;
+          topologicState->statistics.metadata = (m[1] == ":metadata");
+          return true;
+        },
+               "Report the time spent in each phase, the number of faces, "
+               "vertices and duplicates, the size of the output and the peak "
+               "memory use on stderr, as JSON. With :metadata, also add "
+               "these to the SVG metadata."),
+        onumbers("-{0,2}numbers:(float|double|mixed)",
+                 [this](std::smatch & m)->bool {
+                   topologicState->state<Q, 2>::floatVertices =
+                       (m[1] == "mixed");
+                   return true;
+                 },
+                 "Calculate with floats, doubles, or doubles for matrices "
+                 "and floats for vertices. The default is double.") {}
 
-    for (std::size_t i = 0, x = 0; x < d; x++) {
-      for (std::size_t y = 0; y < d; y++) {
-        setMatrixCell(topologicState, d - 1, x, y, v[i]);
-        i++;
+  /**\brief Apply command line arguments
+   *
+   * Applies the given argument vector to the state object this instance was
+   * constructed with. This will also parse XML and JSON files that have been
+   * passed in as command line arguments and set the model in the state object
+   * to match that specified in the arguments or in those files.
+   *
+   * The model is only recreated if the model type, depth, render depth or
+   * vector format has actually changed.
+   *
+   * \param[in] args      Command line argument vector. The first element is
+   *                      the programme name and is ignored.
+   * \param[in] readFiles Try to treat unrecognised options as files.
+   *
+   * \returns The output mode set in the argument vector. Defaults to outNone.
+   */
+  enum outputMode apply(const std::vector<std::string> &args,
+                        bool readFiles = true) {
+    out = outNone;
+    depth = 4;
+    rdepth = 4;
+    model = "cube";
+    format = "cartesian";
+
+    stats &statistics = topologicState->statistics;
+
+    statistics.time("arguments", [&args]() {
+      efgy::cli::options<>::common().remainder.clear();
+      efgy::cli::options<>::common().apply(args);
+    });
+
+    if (readFiles) {
+      for (const auto &f : efgy::cli::options<>::common().remainder) {
+        loadFile(f);
       }
     }
 
-    return true;
-  },
-      "Set a tranformation matrix. Which of the matrices is set depends on the "
-      "number of coordinates given.");
-
-  efgy::cli::options<>::common().apply(args);
+    statistics.time("updateModel", [this]() { selectModel(); });
 
-  if (readFiles) {
-    for (const auto &f : efgy::cli::options<>::common().remainder) {
-      std::ifstream in(f);
-      std::istreambuf_iterator<char> eos;
-      std::string s(std::istreambuf_iterator<char>(in), eos);
+    return out;
+  }
 
+  /**\brief Apply XML or JSON document
+   *
+   * Applies the settings in the given document to the state object. The
+   * document is parsed as XML first, and if that fails it is parsed as a
+   * JSON document instead.
+   *
+   * \param[in] data The contents of the document.
+   * \param[in] name Name of the document, e.g. the file name it was read
+   *                 from. Used as the base for relative references.
+   *
+   * \returns 'true' if the state object has a model after applying the
+   *          document.
+   */
+  bool load(const std::string &data, const std::string &name) {
+    topologicState->statistics.time("files", [this, &data, &name]() {
 #if !defined(NOLIBRARIES)
-      xml::parser p(s, f);
-      if (p.valid) {
-        parse(topologicState, p);
-        parseModel<Q, dim, updateModel>(topologicState, p);
+      xml::reader r(data, name);
+      if (r.valid) {
+        parse(*topologicState, r);
+        parseModel<Q, dim, topologic::updateModel>(*topologicState, r);
       } else
 #endif
-          {
-        efgy::json::value<> v;
-        s >> v;
-        parse(topologicState, v);
-        parseModel<Q, dim, updateModel>(topologicState, v);
+      {
+        parseJSON(data);
       }
+    });
 
-      if (topologicState.model) {
-        format = topologicState.model->formatID;
-        model = topologicState.model->id;
-        depth = topologicState.model->depth;
-        rdepth = topologicState.model->renderDepth;
+    return adopt();
+  }
+
+  /**\brief Apply JSON document
+   *
+   * Like load(), but only tries to parse the document as JSON. Used for
+   * input that is known to be JSON, such as the lines of a JSON Lines
+   * stream.
+   *
+   * \param[in] data The contents of the document.
+   *
+   * \returns 'true' if the document is a JSON state document and the state
+   *          object has a model after applying it.
+   */
+  bool loadJSON(const std::string &data) {
+    bool rv = false;
+    topologicState->statistics.time("files", [this, &data, &rv]() {
+      rv = parseJSON(data);
+    });
+
+    return adopt() && rv;
+  }
+
+  /**\brief Apply XML or JSON file
+   *
+   * Like load(), but reads the document from a file. XML files are read
+   * incrementally, and only up to the end of their metadata, so loading the
+   * settings from a large SVG doesn't mean reading all of its geometry;
+   * anything else is read in full and passed on to load().
+   *
+   * \param[in] file The file to read.
+   *
+   * \returns 'true' if the state object has a model after applying the
+   *          file.
+   */
+  bool loadFile(const std::string &file) {
+#if !defined(NOLIBRARIES)
+    bool isXML = false;
+    topologicState->statistics.time("files", [this, &file, &isXML]() {
+      xml::reader r(file);
+      if ((isXML = r.valid)) {
+        parse(*topologicState, r);
+        parseModel<Q, dim, topologic::updateModel>(*topologicState, r);
       }
+    });
+
+    if (isXML) {
+      return adopt();
     }
+#endif
+
+    std::ifstream in(file);
+    std::istreambuf_iterator<char> eos;
+    std::string s(std::istreambuf_iterator<char>(in), eos);
+
+    return load(s, file);
   }
 
-  if (!topologicState.model ||
-      !((format == topologicState.model->formatID) &&
-        (model == topologicState.model->id) &&
-        (depth == topologicState.model->depth) &&
-        (rdepth == topologicState.model->renderDepth))) {
-    efgy::geometry::with<Q, updateModel, dim>(topologicState, format, model,
-                                              depth, rdepth);
+  /**\brief Bind to state object
+   *
+   * Makes all of the options apply to the given state object from now on,
+   * instead of the one this instance was constructed or last bound with.
+   * This allows using the same set of compiled options for more than one
+   * state object.
+   *
+   * \param[out] pState The topologic::state instance to populate.
+   *
+   * \returns 'true' after the options have been bound to the new state.
+   */
+  bool bind(state<Q, dim> &pState) {
+    topologicState = &pState;
+    return true;
   }
 
-  return out;
+protected:
+  /**\brief Parse JSON document
+   *
+   * Parses the given JSON state document and applies it to the state
+   * object, including its model.
+   *
+   * \param[in] data The contents of the document.
+   *
+   * \returns 'true' if the document is a JSON object with a usable model.
+   */
+  bool parseJSON(std::string data) {
+    efgy::json::value<> v;
+    data >> v;
+    return parse(*topologicState, v) &&
+           parseModel<Q, dim, topologic::updateModel>(*topologicState, v);
+  }
+
+  /**\brief Adopt model settings
+   *
+   * Copies the settings of the state object's model, if there is one, to
+   * the option values, so that later options apply to that model.
+   *
+   * \returns 'true' if the state object has a model.
+   */
+  bool adopt(void) {
+    if (topologicState->model) {
+      format = topologicState->model->formatID;
+      model = topologicState->model->id;
+      depth = topologicState->model->depth;
+      rdepth = topologicState->model->renderDepth;
+    }
+
+    return topologicState->model != 0;
+  }
+
+  /**\brief Update model, if necessary
+   *
+   * Creates a new model for the state object if there isn't one yet, or if
+   * the model type, depth, render depth or vector format that have been set
+   * differ from those of the current model.
+   *
+   * \returns 'true' if the state object has a model.
+   */
+  bool selectModel(void) {
+    if (!topologicState->model ||
+        !((format == topologicState->model->formatID) &&
+          (model == topologicState->model->id) &&
+          (depth == topologicState->model->depth) &&
+          (rdepth == topologicState->model->renderDepth))) {
+      factory<Q, dim, topologic::updateModel>::create(*topologicState, format,
+                                                      model, depth, rdepth);
+    }
+
+    return topologicState->model != 0;
+  }
+
+  /**\brief State object
+   *
+   * The topologic::state instance that the options are applied to.
+   */
+  state<Q, dim> *topologicState;
+
+  /**\brief Selected output mode
+   *
+   * The output mode selected by the most recently applied arguments.
+   */
+  enum outputMode out;
+
+  /**\brief Selected model depth */
+  std::size_t depth;
+
+  /**\brief Selected model render depth */
+  std::size_t rdepth;
+
+  /**\brief Selected model type */
+  std::string model;
+
+  /**\brief Selected vector coordinate format */
+  std::string format;
+
+#if !defined(NOLIBRARIES)
+  /**\brief XML parser library context
+   *
+   * Initialises libxml2 for as long as this object lives, so that it need
+   * not be initialised again for each file that is being read.
+   */
+  topologic::xml XML;
+#endif
+
+  efgy::cli::option oversion;
+  efgy::cli::option omodel;
+  efgy::cli::option oformat;
+  efgy::cli::option oifs;
+  efgy::cli::option ocolour;
+  efgy::cli::option oradius;
+  efgy::cli::option oparam;
+  efgy::cli::option oiterations;
+  efgy::cli::option ofrom;
+  efgy::cli::option otransform;
+  efgy::cli::option oprojection;
+  efgy::cli::option ocacheDirectory;
+  efgy::cli::option ocacheSize;
+  efgy::cli::option omaxMemory;
+  efgy::cli::option olod;
+  efgy::cli::option osamples;
+  efgy::cli::option odedup;
+  efgy::cli::option osize;
+  efgy::cli::option ostats;
+  efgy::cli::option onumbers;
+};
+
+/**\brief Parse command line arguments
+ *
+ * A function template to parse C-style command line arguments, apply the
+ * settings in those arguments to a topologic::state instance. This
+ * function will also parse XML files that have been passed in as command
+ * line arguments and set the model in the state object to match that
+ * specified as command line arguments or in XML files.
+ *
+ * This compiles the full set of options each time it's called; use an
+ * instance of topologic::arguments directly if you need to apply more than
+ * one set of arguments.
+ *
+ * \tparam Q   Base data type as used in the topologic::state instance
+ * \tparam dim Maximum render depth of the topologic::state instance
+ *
+ * \param[out] topologicState The topologic::state instance to populate
+ * \param[in]  args           Command line argument vector.
+ * \param[in]  readFiles      Try to treat unrecognised options as files.
+ *
+ * \returns The output mode set in the argument vector. Defaults to outNone.
+ */
+template <typename Q, std::size_t dim>
+enum outputMode parse(state<Q, dim> &topologicState,
+                      const std::vector<std::string> &args,
+                      bool readFiles = true) {
+  arguments<Q, dim> options(topologicState);
+  return options.apply(args, readFiles);
 }
 }
 
@@ -0,0 +1,770 @@
+/**\file
+ * \brief Batch rendering
+ *
+ * Contains the code needed to render a whole batch of jobs with a single
+ * topologic::state instance, instead of having to start a new process for
+ * each and every output file. Jobs are read from a manifest with one job per
+ * line.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_BATCH_H)
+#define TOPOLOGIC_BATCH_H
+
+#include <topologic/arguments.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <thread>
+#include <type_traits>
+
+namespace topologic {
+/**\brief Render state to stream
+ *
+ * Renders the model of the given state object to the given stream, using the
+ * specified output mode. Used by write(), which checks that there is a model
+ * and keeps track of statistics.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum render depth of the state object.
+ *
+ * \param[out] stream         The stream to write to.
+ * \param[in]  topologicState The state object to render.
+ * \param[in]  out            The output mode to use.
+ * \param[in]  direct         Whether the stream ends up on stdout, in which
+ *                            case streaming output may bypass it and write
+ *                            to the file descriptor directly.
+ *
+ * \returns 'true' if the model was rendered successfully.
+ */
+template <typename Q, std::size_t d>
+static bool emit(std::ostream &stream, const state<Q, d> &topologicState,
+                 enum outputMode out, bool direct) {
+  if (out == outSVG) {
+    stream << efgy::svg::tag() << topologicState;
+  } else if (out == outJSON) {
+    stream << efgy::json::tag() << topologicState;
+  } else if (out == outArguments) {
+    std::vector<std::string> v;
+    stream << "topologic";
+    for (const auto &arg : topologicState.args(v)) {
+      stream << " " << arg;
+    }
+    stream << "\n";
+  } else if ((out == outMesh) || (out == outMeshFull)) {
+    return topologicState.model->mesh(stream, true, out == outMeshFull);
+  } else if (out == outSVGStream) {
+    std::unique_ptr<sink> output;
+    if (direct) {
+      stream.flush();
+      output.reset(new sink(STDOUT_FILENO));
+    } else {
+      output.reset(new sink(stream));
+    }
+    const bool rv = topologicState.model->svg(*output, true);
+    if (direct) {
+      topologicState.statistics.bytes += output->bytes;
+    }
+    return rv;
+  } else if ((out == outPPM) || (out == outPNG)) {
+    return topologicState.model->raster(stream, true, out == outPNG);
+  } else if ((out == outPoints) || (out == outPointsFull)) {
+    return topologicState.model->points(stream, true, out == outPointsFull);
+  }
+
+  return true;
+}
+
+/**\brief Write state to stream
+ *
+ * Renders the model of the given state object to the given stream, using the
+ * specified output mode. The time this takes is recorded in the state's
+ * statistics, and if those are enabled, so is the size of the output.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum render depth of the state object.
+ *
+ * \param[out] stream         The stream to write to.
+ * \param[in]  topologicState The state object to render.
+ * \param[in]  out            The output mode to use.
+ *
+ * \returns 'true' if there was a model to render, 'false' otherwise.
+ */
+template <typename Q, std::size_t d>
+static bool write(std::ostream &stream, const state<Q, d> &topologicState,
+                  enum outputMode out) {
+  if (!topologicState.model) {
+    std::cerr << "error: no model to render\n";
+    return false;
+  }
+
+  stats &statistics = topologicState.statistics;
+  const bool direct = (&stream == &std::cout);
+  bool rv = true;
+
+  if (!statistics.enabled) {
+    statistics.time("output", [&]() {
+      rv = emit(stream, topologicState, out, direct);
+    });
+    return rv;
+  }
+
+  countingBuffer counter(stream.rdbuf());
+  std::ostream output(&counter);
+  statistics.time("output", [&]() {
+    rv = emit(output, topologicState, out, direct);
+    output.flush();
+  });
+  statistics.bytes += counter.bytes;
+
+  return rv;
+}
+
+/**\brief Batch rendering job
+ *
+ * A single job in a batch manifest. Each line of a manifest describes one
+ * job, which is of the form "OUTPUT ARGUMENTS..." or "OUTPUT {JSON}"; that
+ * is, the name of the file to write to, followed by either a list of
+ * arguments in the same format as those accepted on the command line, or a
+ * JSON state document as produced by the JSON output mode.
+ *
+ * An output file name of "-" means that the result is written to stdout.
+ */
+class job {
+public:
+  /**\brief Parse manifest line
+   *
+   * Sets up the job as described by the given line of a manifest.
+   *
+   * \param[in] line A single line of a batch manifest.
+   *
+   * \returns 'true' if the line describes a job, 'false' if it doesn't,
+   *          e.g. because it's empty or a comment.
+   */
+  bool read(const std::string &line) {
+    std::istringstream s(line);
+
+    output = "";
+    document = "";
+    arguments.clear();
+
+    if (!(s >> output) || (output[0] == '#')) {
+      return false;
+    }
+
+    s >> std::ws;
+    if (s.peek() == '{') {
+      std::istreambuf_iterator<char> eos;
+      document = std::string(std::istreambuf_iterator<char>(s), eos);
+      return true;
+    }
+
+    std::string arg;
+    arguments.push_back("topologic");
+    while (s >> arg) {
+      arguments.push_back(arg);
+    }
+
+    return true;
+  }
+
+  /**\brief Output file name
+   *
+   * Where to write the result of this job to; "-" for stdout.
+   */
+  std::string output;
+
+  /**\brief Argument vector
+   *
+   * Arguments to apply for this job. As with a regular argument vector, the
+   * first element is the programme name. Empty if the job is described by a
+   * JSON document instead.
+   */
+  std::vector<std::string> arguments;
+
+  /**\brief JSON state document
+   *
+   * The JSON state document that describes this job. Empty if the job is
+   * described by an argument vector instead.
+   */
+  std::string document;
+};
+
+/**\brief Is argument a frontend option?
+ *
+ * The batch, jobs, ordered, daemon and jsonl options of the CLI frontend
+ * control how the frontend runs rather than what a job renders. They stay
+ * registered while jobs are applied, so they have to be kept out of jobs
+ * explicitly. The same goes for the stats option: reset() doesn't reset
+ * whether statistics are reported, so a job that turned them on would
+ * leave them on for all the later jobs of the same state object.
+ *
+ * \param[in] arg The argument to check.
+ *
+ * \returns 'true' if the argument is one of the frontend's own options.
+ */
+static bool frontendOption(const std::string &arg) {
+  static const std::regex options(
+      "-{0,2}(batch(:(.+))?|(j|jobs):([0-9]+)|ordered|daemon:(.+)|"
+      "jsonl(:(.+))?|stats(:metadata)?)");
+  return std::regex_match(arg, options);
+}
+
+/**\brief Is argument a process option?
+ *
+ * The cache-dir, cache-size and max-memory options decide how the process
+ * uses the file system and memory, rather than what a job renders. Daemon
+ * requests come from other processes, which must not be able to change
+ * these.
+ *
+ * \param[in] arg The argument to check.
+ *
+ * \returns 'true' if the argument sets up the process.
+ */
+static bool processOption(const std::string &arg) {
+  static const std::regex options("-{0,2}(cache-dir|cache-size|max-memory):.*");
+  return std::regex_match(arg, options);
+}
+
+/**\brief Does argument ask for a different data type?
+ *
+ * The data type that a frontend calculates with is chosen once, before any
+ * job is read, so jobs can't switch between floats and doubles; they can
+ * only choose whether to project vertices as floats with "numbers:mixed".
+ *
+ * \tparam Q Base data type of the frontend.
+ *
+ * \param[in] arg The argument to check.
+ *
+ * \returns 'true' if the argument selects floats or doubles, and Q is not
+ *          that type.
+ */
+template <typename Q> static bool otherNumbers(const std::string &arg) {
+  static const std::regex numbers("-{0,2}numbers:(float|double)");
+  std::smatch m;
+  return std::regex_match(arg, m, numbers) &&
+         ((m[1] == "float") != std::is_same<Q, float>::value);
+}
+
+/**\brief Prepare batch job
+ *
+ * Resets the given state object and applies the settings of a batch job to
+ * it. The model of the state object is kept unless the job asks for a
+ * different one. Jobs that use any of the frontend's own options, or that
+ * ask for a different data type than the frontend's, are rejected.
+ *
+ * Requests, i.e. jobs that were sent to a daemon by another process, are
+ * more restricted: they may not change the process options, they may not
+ * name files to read settings from, and their documents have to be JSON,
+ * as XML documents can refer to other files.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth of the state object.
+ *
+ * \param[in,out] options        Compiled command line options, bound to
+ *                               topologicState.
+ * \param[in,out] topologicState The state object to render with.
+ * \param[in]     j              The job to prepare.
+ * \param[in,out] out            Output mode; updated if the job specifies
+ *                               one.
+ * \param[in]     request        Whether the job is a daemon request.
+ *
+ * \returns 'true' if the job's settings were applied successfully.
+ */
+template <typename Q, std::size_t dim>
+static bool prepare(arguments<Q, dim> &options, state<Q, dim> &topologicState,
+                    const job &j, enum outputMode &out, bool request = false) {
+  topologicState.reset();
+
+  if (j.document != "") {
+    return request ? options.loadJSON(j.document)
+                   : options.load(j.document, j.output);
+  }
+
+  for (const auto &arg : j.arguments) {
+    if (frontendOption(arg)) {
+      std::cerr << "error: option not allowed in a job: " << arg << "\n";
+      return false;
+    }
+    if (request && processOption(arg)) {
+      std::cerr << "error: option not allowed in a request: " << arg << "\n";
+      return false;
+    }
+    if (otherNumbers<Q>(arg)) {
+      std::cerr << "error: " << arg << " can only be used on the command "
+                   "line\n";
+      return false;
+    }
+  }
+
+  enum outputMode o = options.apply(j.arguments, !request);
+  if (o != outNone) {
+    out = o;
+  }
+
+  if (request) {
+    for (const auto &arg : efgy::cli::options<>::common().remainder) {
+      std::cerr << "error: requests can't read files: " << arg << "\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**\brief Run batch job
+ *
+ * Prepares the given state object for a batch job, then renders the result
+ * to the given stream.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth of the state object.
+ *
+ * \param[in,out] options        Compiled command line options, bound to
+ *                               topologicState.
+ * \param[in,out] topologicState The state object to render with.
+ * \param[in]     j              The job to run.
+ * \param[in]     out            Output mode to use if the job doesn't
+ *                               specify one.
+ * \param[out]    stream         Where to write the result to.
+ *
+ * \returns 'true' if the job was rendered successfully.
+ */
+template <typename Q, std::size_t dim>
+static bool run(arguments<Q, dim> &options, state<Q, dim> &topologicState,
+                const job &j, enum outputMode out, std::ostream &stream) {
+  return prepare(options, topologicState, j, out) &&
+         write(stream, topologicState, out);
+}
+
+/**\brief Write job result
+ *
+ * Writes the rendered result of a batch job to the output file named in the
+ * job, or to stdout if that name is "-".
+ *
+ * \param[in] j      The job that produced the output.
+ * \param[in] result The rendered output.
+ *
+ * \returns 'true' if the output was written successfully.
+ */
+static bool commit(const job &j, const std::string &result) {
+  if (j.output == "-") {
+    std::cout << result;
+    return bool(std::cout);
+  }
+
+  std::ofstream stream(j.output);
+  if (!stream) {
+    std::cerr << "error: could not open output file " << j.output << "\n";
+    return false;
+  }
+
+  stream << result;
+  return bool(stream);
+}
+
+/**\brief Parallel batch executor
+ *
+ * Renders a batch of jobs with a pool of worker threads, each of which has
+ * its own, private topologic::state instance. Jobs are distributed to the
+ * workers in contiguous blocks, and workers that run out of jobs steal
+ * pending jobs from the back of the other workers' queues.
+ *
+ * All of the workers share a single set of compiled options, which is only
+ * used by one worker at a time. Since every job starts from a freshly reset
+ * state, the output of each job is identical to what a serial run would
+ * have produced. If requested, results are written in the order that the
+ * jobs were submitted in; otherwise they're written as soon as they're done.
+ *
+ * Each worker's state object only sees some of the earlier jobs, and which
+ * ones depends on scheduling, so no setting that affects the output may
+ * carry over from one job to the next: state::reset() has to restore all of
+ * them, including the numbers, lod, samples and dedup settings. The only
+ * settings that are kept are the cache directory, the cache and memory
+ * budgets and the statistics, none of which change what a job writes.
+ * These are copied from the state object that the batch was started with,
+ * and the workers' statistics are added to that state's once the batch is
+ * done.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth of the state objects.
+ */
+template <typename Q, std::size_t dim> class executor {
+public:
+  /**\brief Construct with options and settings
+   *
+   * Sets up the worker queues and state objects, but doesn't start any
+   * threads just yet.
+   *
+   * \param[in,out] pOptions Compiled command line options to use.
+   * \param[in,out] pState   State object that the batch was started with;
+   *                         the workers take its process settings, and
+   *                         their statistics are added to it.
+   * \param[in]     pThreads Number of worker threads; 0 to use as many
+   *                         threads as there are hardware threads.
+   * \param[in]     pOrdered Whether to write results in submission order.
+   * \param[in]     pOut     Output mode for jobs that don't specify one.
+   */
+  executor(arguments<Q, dim> &pOptions, state<Q, dim> &pState,
+           std::size_t pThreads, bool pOrdered, enum outputMode pOut)
+      : options(pOptions), topologicState(pState), ordered(pOrdered),
+        out(pOut), next(0), rv(true) {
+    if (pThreads == 0) {
+      pThreads = std::thread::hardware_concurrency();
+    }
+    if (pThreads == 0) {
+      pThreads = 1;
+    }
+
+    for (std::size_t i = 0; i < pThreads; i++) {
+      workers.emplace_back(new worker());
+      workers.back()->topologicState.inherit(topologicState);
+    }
+  }
+
+  /**\brief Run batch
+   *
+   * Renders all of the given jobs and returns once they're all done.
+   *
+   * \param[in] pJobs The jobs to render.
+   *
+   * \returns 'true' if all of the jobs were rendered successfully.
+   */
+  bool run(const std::vector<job> &pJobs) {
+    jobs = &pJobs;
+    next = 0;
+    rv = true;
+    if (ordered) {
+      results.assign(jobs->size(), result());
+    }
+
+    const std::size_t n = workers.size();
+    for (std::size_t i = 0; i < jobs->size(); i++) {
+      workers[i * n / jobs->size()]->queue.push_back(i);
+    }
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < n; i++) {
+      threads.emplace_back([this, i]() { work(i); });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    for (auto &w : workers) {
+      topologicState.statistics.merge(w->topologicState.statistics);
+      w->topologicState.statistics.clear();
+    }
+
+    return rv;
+  }
+
+protected:
+  /**\brief Worker context
+   *
+   * Each worker has its own state object and a queue of job indices that
+   * it's been assigned.
+   */
+  class worker {
+  public:
+    /**\brief Private state object */
+    state<Q, dim> topologicState;
+
+    /**\brief Pending jobs
+     *
+     * Indices of jobs that are assigned to this worker. The owner takes
+     * jobs from the front, other workers steal from the back.
+     */
+    std::deque<std::size_t> queue;
+
+    /**\brief Queue lock */
+    std::mutex lock;
+  };
+
+  /**\brief Rendered job
+   *
+   * In ordered mode, results are kept here until all of the jobs before
+   * them have been written.
+   */
+  class result {
+  public:
+    /**\brief Default constructor */
+    result(void) : done(false), ok(false) {}
+
+    /**\brief The rendered output */
+    std::string data;
+
+    /**\brief Has the job been rendered? */
+    bool done;
+
+    /**\brief Was the job rendered successfully? */
+    bool ok;
+  };
+
+  /**\brief Fetch next job
+   *
+   * Takes the next job from the given worker's own queue, or steals one from
+   * another worker's queue if there are no more jobs in its own.
+   *
+   * \param[in]  i   Index of the worker that wants a job.
+   * \param[out] job Set to the index of the job to run.
+   *
+   * \returns 'true' if there was a job left to run.
+   */
+  bool fetch(std::size_t i, std::size_t &job) {
+    {
+      std::lock_guard<std::mutex> l(workers[i]->lock);
+      if (!workers[i]->queue.empty()) {
+        job = workers[i]->queue.front();
+        workers[i]->queue.pop_front();
+        return true;
+      }
+    }
+
+    for (std::size_t k = 1; k < workers.size(); k++) {
+      worker &victim = *workers[(i + k) % workers.size()];
+      std::lock_guard<std::mutex> l(victim.lock);
+      if (!victim.queue.empty()) {
+        job = victim.queue.back();
+        victim.queue.pop_back();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**\brief Worker thread
+   *
+   * Keeps fetching and rendering jobs until there are none left. Unless
+   * results have to be written in order, jobs with an output file render
+   * straight into that file. Results for stdout and results that have to
+   * wait for their turn are rendered to memory first. Workers never wait
+   * for their turn: in ordered mode, whichever worker finishes the next job
+   * to be written also writes all of the finished results after it.
+   *
+   * \param[in] i Index of the worker to run as.
+   */
+  void work(std::size_t i) {
+    worker &w = *workers[i];
+    std::size_t id;
+
+    while (fetch(i, id)) {
+      const job &j = (*jobs)[id];
+      enum outputMode o = out;
+      bool ok;
+
+      {
+        std::lock_guard<std::mutex> l(optionsLock);
+        options.bind(w.topologicState);
+        ok = prepare(options, w.topologicState, j, o);
+      }
+
+      if (!ordered && (j.output != "-")) {
+        std::ofstream stream(j.output);
+        if (!stream) {
+          std::cerr << "error: could not open output file " << j.output
+                    << "\n";
+          ok = false;
+        }
+        ok = ok && write(stream, w.topologicState, o) && bool(stream);
+
+        std::lock_guard<std::mutex> l(outputLock);
+        rv = rv && ok;
+        next++;
+        continue;
+      }
+
+      std::ostringstream stream;
+      ok = ok && write(stream, w.topologicState, o);
+
+      std::lock_guard<std::mutex> l(outputLock);
+      if (!ordered) {
+        ok = ok && commit(j, stream.str());
+        rv = rv && ok;
+        next++;
+        continue;
+      }
+
+      results[id].data = stream.str();
+      results[id].done = true;
+      results[id].ok = ok;
+      for (; (next < results.size()) && results[next].done; next++) {
+        result &r = results[next];
+        r.ok = r.ok && commit((*jobs)[next], r.data);
+        rv = rv && r.ok;
+        std::string().swap(r.data);
+      }
+    }
+  }
+
+  /**\brief Compiled command line options */
+  arguments<Q, dim> &options;
+
+  /**\brief State object that the batch was started with */
+  state<Q, dim> &topologicState;
+
+  /**\brief Lock for the compiled options
+   *
+   * Options are registered globally, so only one worker at a time may use
+   * them to prepare its state object.
+   */
+  std::mutex optionsLock;
+
+  /**\brief Write results in submission order? */
+  const bool ordered;
+
+  /**\brief Output mode for jobs that don't specify one */
+  const enum outputMode out;
+
+  /**\brief Jobs of the batch that is currently running */
+  const std::vector<job> *jobs;
+
+  /**\brief Worker contexts */
+  std::vector<std::unique_ptr<worker>> workers;
+
+  /**\brief Lock for writing results */
+  std::mutex outputLock;
+
+  /**\brief Results waiting to be written, in ordered mode */
+  std::vector<result> results;
+
+  /**\brief Number of results written so far
+   *
+   * In ordered mode, this is also the index of the next job whose result
+   * may be written.
+   */
+  std::size_t next;
+
+  /**\brief Overall result; 'false' if any of the jobs failed */
+  bool rv;
+};
+
+/**\brief Render batch of jobs
+ *
+ * Reads a batch manifest from the given stream and runs each of the jobs in
+ * there. With a single thread, jobs are run in order with the same state
+ * object and options that were used to parse the command line, and each
+ * result is written straight to its output file. With more than one thread,
+ * the whole manifest is read first and then handed to a
+ * topologic::executor.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth of the state object.
+ *
+ * \param[in,out] options        Compiled command line options, bound to
+ *                               topologicState.
+ * \param[in,out] topologicState The state object to render with.
+ * \param[in]     manifest       Stream to read the batch manifest from.
+ * \param[in]     out            Output mode for jobs that don't specify one.
+ * \param[in]     threads        Number of worker threads; 0 to use all of
+ *                               the available hardware threads.
+ * \param[in]     ordered        Whether to write results in submission order
+ *                               when using more than one thread.
+ *
+ * \returns 'true' if all of the jobs were rendered successfully.
+ */
+template <typename Q, std::size_t dim>
+static bool batch(arguments<Q, dim> &options, state<Q, dim> &topologicState,
+                  std::istream &manifest, enum outputMode out,
+                  std::size_t threads = 1, bool ordered = false) {
+  bool rv = true;
+  std::string line;
+  job j;
+
+  if (threads != 1) {
+    std::vector<job> jobs;
+    while (std::getline(manifest, line)) {
+      if (j.read(line)) {
+        jobs.push_back(j);
+      }
+    }
+
+    executor<Q, dim> e(options, topologicState, threads, ordered, out);
+    rv = e.run(jobs);
+    options.bind(topologicState);
+    return rv;
+  }
+
+  while (std::getline(manifest, line)) {
+    if (!j.read(line)) {
+      continue;
+    }
+
+    if (j.output == "-") {
+      rv = run(options, topologicState, j, out, std::cout) && rv;
+    } else {
+      std::ofstream stream(j.output);
+      if (!stream) {
+        std::cerr << "error: could not open output file " << j.output << "\n";
+        rv = false;
+        continue;
+      }
+      rv = run(options, topologicState, j, out, stream) && rv;
+    }
+  }
+
+  return rv;
+}
+
+/**\brief Render JSON Lines stream
+ *
+ * Reads a stream of JSON state documents, one per line, as produced by the
+ * JSON output mode, and renders each of them to stdout as soon as it has
+ * been read. Each document is applied to a freshly reset state object, which
+ * keeps its model unless a document asks for a different one. Only one line
+ * is held in memory at any time, so arbitrarily long streams can be piped
+ * through.
+ *
+ * Empty lines are skipped; lines that aren't JSON state documents are
+ * reported and skipped as well.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth of the state object.
+ *
+ * \param[in,out] options        Compiled command line options, bound to
+ *                               topologicState.
+ * \param[in,out] topologicState The state object to render with.
+ * \param[in]     input          Stream to read the documents from.
+ * \param[in]     out            Output mode to render the documents with.
+ *
+ * \returns 'true' if all of the documents were rendered successfully.
+ */
+template <typename Q, std::size_t dim>
+static bool jsonLines(arguments<Q, dim> &options, state<Q, dim> &topologicState,
+                      std::istream &input, enum outputMode out) {
+  bool rv = true;
+  std::string line;
+
+  for (std::size_t n = 1; std::getline(input, line); n++) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+
+    topologicState.reset();
+    if (!options.loadJSON(line)) {
+      std::cerr << "error: line " << n << " is not a JSON state document\n";
+      rv = false;
+      continue;
+    }
+
+    rv = write(std::cout, topologicState, out) && rv;
+    std::cout.flush();
+  }
+
+  return rv;
+}
+}
+
+#endif
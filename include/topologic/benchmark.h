@@ -0,0 +1,335 @@
+/**\file
+ * \brief Benchmark harness
+ *
+ * Contains a harness that times the individual stages of rendering each of
+ * the supported models with a grid of settings, so that performance
+ * regressions - e.g. after changing MAXDEPTH or the default precision - show
+ * up before they're released. Results are written as JSON.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_BENCHMARK_H)
+#define TOPOLOGIC_BENCHMARK_H
+
+#include <topologic/cli.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <sstream>
+
+namespace topologic {
+/**\brief Benchmark harness
+ *
+ * Contains the timing helpers and the grid that the benchmark runs over.
+ */
+namespace benchmark {
+/**\brief Timing results
+ *
+ * Wall clock times of all the repetitions of a single measurement.
+ */
+class timing {
+public:
+  /**\brief Fastest repetition, in nanoseconds */
+  double min(void) const {
+    return samples.empty() ? 0. : *std::min_element(samples.begin(),
+                                                    samples.end());
+  }
+
+  /**\brief Median of all repetitions, in nanoseconds */
+  double median(void) const {
+    if (samples.empty()) {
+      return 0.;
+    }
+    std::vector<double> s = samples;
+    std::sort(s.begin(), s.end());
+    return s.size() % 2 ? s[s.size() / 2]
+                        : (s[s.size() / 2 - 1] + s[s.size() / 2]) / 2.;
+  }
+
+  /**\brief Times of the individual repetitions, in nanoseconds */
+  std::vector<double> samples;
+};
+
+/**\brief Write timing as JSON
+ *
+ * \param[out] output The stream to write to.
+ * \param[in]  t      The timing results to write.
+ *
+ * \returns The stream that was passed in.
+ */
+static std::ostream &operator<<(std::ostream &output, const timing &t) {
+  return output << "{\"min\":" << t.min() << ",\"median\":" << t.median()
+                << ",\"repetitions\":" << t.samples.size() << "}";
+}
+
+/**\brief Time function
+ *
+ * Runs a function a number of times and records how long each run took.
+ *
+ * \tparam F Function type; called without arguments.
+ *
+ * \param[in] repetitions How often to run the function.
+ * \param[in] f           The function to time.
+ *
+ * \returns The times of all the runs.
+ */
+template <typename F> static timing measure(std::size_t repetitions, F f) {
+  timing t;
+  for (std::size_t i = 0; i < repetitions; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    t.samples.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  return t;
+}
+
+/**\brief Benchmark grid
+ *
+ * The settings to benchmark each model with. Every combination of depth,
+ * render depth, precision and iterations is tried for every model; those
+ * that a model doesn't support are skipped.
+ */
+class grid {
+public:
+  /**\brief Construct with default grid */
+  grid(void)
+      : depths({2, 3, 4}), renderDepths({3, 4, 5}), precisions({10, 20}),
+        iterations({2, 4}), repetitions(5), format("cartesian") {}
+
+  /**\brief Model depths */
+  std::vector<std::size_t> depths;
+
+  /**\brief Render depths */
+  std::vector<std::size_t> renderDepths;
+
+  /**\brief Values for parameter.precision */
+  std::vector<double> precisions;
+
+  /**\brief Values for parameter.iterations */
+  std::vector<std::size_t> iterations;
+
+  /**\brief Number of times each measurement is repeated */
+  std::size_t repetitions;
+
+  /**\brief Vector coordinate format to use */
+  std::string format;
+
+  /**\brief Models to benchmark; empty for all supported models */
+  std::set<std::string> models;
+};
+
+/**\brief Parse list of numbers
+ *
+ * \tparam T Type of the numbers.
+ *
+ * \param[in] s A comma-separated list of numbers.
+ *
+ * \returns The numbers in the list.
+ */
+template <typename T> static std::vector<T> list(const std::string &s) {
+  std::vector<T> rv;
+  std::istringstream in(s);
+  std::string n;
+  while (std::getline(in, n, ',')) {
+    rv.push_back(T(std::stod(n)));
+  }
+  return rv;
+}
+
+/**\brief Run benchmark
+ *
+ * Times model construction, matrix updates, SVG rendering and JSON
+ * serialisation for each of the supported models at each point of the
+ * grid, and writes the results as a JSON document. Times are in
+ * nanoseconds.
+ *
+ * Model construction is timed with a state object that has no model yet, so
+ * every repetition creates a new one. SVG rendering includes generating the
+ * model's geometry, as the model is told to update itself before each
+ * repetition.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth.
+ *
+ * \param[out] output The stream to write the results to.
+ * \param[in]  g      The grid to benchmark.
+ *
+ * \returns 'true' if at least one combination was benchmarked.
+ */
+template <typename Q, std::size_t dim>
+static bool run(std::ostream &output, const grid &g) {
+  state<Q, dim> s;
+  std::set<const char *> models;
+  bool first = true;
+
+  output << "{\"version\":" << version << ",\"maxDepth\":" << dim
+         << ",\"format\":\"" << g.format << "\",\"results\":[";
+
+  for (const char *m :
+       efgy::geometry::with<Q, efgy::geometry::functor::models, dim>(models,
+                                                                      "*", 0,
+                                                                      0)) {
+    const std::string model = m;
+    if (!g.models.empty() && (g.models.find(model) == g.models.end())) {
+      continue;
+    }
+
+    for (const std::size_t &d : g.depths) {
+      for (const std::size_t &r : g.renderDepths) {
+        for (const double &p : g.precisions) {
+          for (const std::size_t &i : g.iterations) {
+            bool ok = true;
+            s.reset();
+            s.parameter.precision = Q(p);
+            s.parameter.iterations = i;
+
+            const timing construct = measure(g.repetitions, [&]() {
+              delete s.model;
+              s.model = 0;
+              ok = factory<Q, dim, updateModel>::create(s, g.format, model, d,
+                                                        r) &&
+                   ok;
+            });
+            if (!ok || !s.model) {
+              continue;
+            }
+
+            const timing matrix = measure(g.repetitions, [&]() {
+              s.invalidateMatrix();
+              s.updateMatrix();
+            });
+
+            std::size_t svgBytes = 0;
+            const timing svg = measure(g.repetitions, [&]() {
+              std::ostringstream o;
+              s.model->update = true;
+              s.model->svg(o, true);
+              svgBytes = o.str().size();
+            });
+
+            std::size_t jsonBytes = 0;
+            const timing json = measure(g.repetitions, [&]() {
+              std::ostringstream o;
+              o << efgy::json::tag() << s;
+              jsonBytes = o.str().size();
+            });
+
+            output << (first ? "" : ",") << "\n{\"model\":\"" << model
+                   << "\",\"depth\":" << d << ",\"renderDepth\":" << r
+                   << ",\"precision\":" << p << ",\"iterations\":" << i
+                   << ",\"construct\":" << construct
+                   << ",\"updateMatrix\":" << matrix << ",\"svg\":" << svg
+                   << ",\"svgBytes\":" << svgBytes << ",\"json\":" << json
+                   << ",\"jsonBytes\":" << jsonBytes << "}";
+            first = false;
+          }
+        }
+      }
+    }
+  }
+
+  output << "\n]}\n";
+
+  return !first;
+}
+}
+
+/**\brief Benchmark frontend main function
+ *
+ * Main function for the benchmark harness. Reads the grid to benchmark from
+ * the command line and writes the results to stdout.
+ *
+ * \tparam FP Floating point data type to use; something like double
+ *
+ * \param[in] argc The number of arguments that are being passed in argv.
+ * \param[in] argv The actual argument vector. The first element must be
+ *                 the name the programme was called as, the remainder are
+ *                 command line flags.
+ *
+ * \returns 0 if the function ran correctly, nonzero otherwise.
+ */
+template <typename FP> int benchmarks(int argc, char *argv[]) {
+  benchmark::grid g;
+  std::vector<std::string> args;
+
+  efgy::cli::option omodels("-{0,2}models:([a-z,-]+)",
+                            [&g](std::smatch & m)->bool {
+    std::istringstream in(m[1]);
+    std::string model;
+    while (std::getline(in, model, ',')) {
+      g.models.insert(model);
+    }
+    return true;
+  },
+                            "Only benchmark the given, comma-separated models.");
+
+  efgy::cli::option odepths("-{0,2}depths:([0-9,]+)",
+                            [&g](std::smatch & m)->bool {
+    g.depths = benchmark::list<std::size_t>(m[1]);
+    return true;
+  },
+                            "Model depths to benchmark; default: 2,3,4.");
+
+  efgy::cli::option orenderDepths("-{0,2}render-depths:([0-9,]+)",
+                                  [&g](std::smatch & m)->bool {
+    g.renderDepths = benchmark::list<std::size_t>(m[1]);
+    return true;
+  },
+                                  "Render depths to benchmark; default: "
+                                  "3,4,5.");
+
+  efgy::cli::option oprecisions("-{0,2}precisions:([0-9.,]+)",
+                                [&g](std::smatch & m)->bool {
+    g.precisions = benchmark::list<double>(m[1]);
+    return true;
+  },
+                                "Model precisions to benchmark; default: "
+                                "10,20.");
+
+  efgy::cli::option oiterations("-{0,2}iterations:([0-9,]+)",
+                                [&g](std::smatch & m)->bool {
+    g.iterations = benchmark::list<std::size_t>(m[1]);
+    return true;
+  },
+                                "IFS iterations to benchmark; default: 2,4.");
+
+  efgy::cli::option orepetitions("-{0,2}repetitions:([0-9]+)",
+                                 [&g](std::smatch & m)->bool {
+    g.repetitions = std::stoul(m[1]);
+    return true;
+  },
+                                 "How often to repeat each measurement; "
+                                 "default: 5.");
+
+  efgy::cli::option oformat("-{0,2}format:([a-z]+)",
+                            [&g](std::smatch & m)->bool {
+    g.format = m[1];
+    return true;
+  },
+                            "Vector coordinate format; default: cartesian.");
+
+  for (std::size_t i = 0; i < argc; i++) {
+    args.push_back(argv[i]);
+  }
+
+  efgy::cli::options<>::common().apply(args);
+
+  if (!benchmark::run<FP, MAXDEPTH>(std::cout, g)) {
+    std::cerr << "error: no models matched the benchmark grid\n";
+    return 1;
+  }
+
+  return 0;
+}
+}
+
+#endif
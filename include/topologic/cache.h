@@ -0,0 +1,334 @@
+/**\file
+ * \brief On-disk geometry cache
+ *
+ * Generating the geometry of some of the models - high-precision spheres and
+ * deep IFSs in particular - takes a lot longer than rendering it. The
+ * functions in this file store generated geometry in a directory, in a simple
+ * binary layout that can be mapped straight into memory, so that other
+ * processes can reuse it instead of having to generate it all over again.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_CACHE_H)
+#define TOPOLOGIC_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace topologic {
+/**\brief On-disk geometry cache
+ *
+ * Cache files are named after a hash of their key and contain a fixed-size
+ * header, the full key and then the geometry as a flat array of scalars, in
+ * the native byte order and format of the machine that wrote them. The
+ * header and the key are checked when a file is loaded, so files written on
+ * a different kind of machine or hash collisions are simply treated as cache
+ * misses.
+ */
+namespace cache {
+/**\brief Cache file header
+ *
+ * Describes the layout of a cache file. The key follows right after the
+ * header, and the data follows at 'dataOffset', which is aligned to 64 bytes
+ * so that it can be used straight from a memory mapping.
+ */
+struct header {
+  /**\brief File magic; always "TOPOGEO" */
+  char magic[8];
+
+  /**\brief Byte order marker; 0x01020304 in the writer's byte order */
+  std::uint32_t byteOrder;
+
+  /**\brief Layout version; currently 1 */
+  std::uint32_t version;
+
+  /**\brief Size of a single scalar, in bytes */
+  std::uint32_t scalarSize;
+
+  /**\brief Number of dimensions per vertex */
+  std::uint32_t dimensions;
+
+  /**\brief Number of vertices per face */
+  std::uint32_t faceVertices;
+
+  /**\brief Length of the key, in bytes */
+  std::uint32_t keyLength;
+
+  /**\brief Number of faces in the file */
+  std::uint64_t faces;
+
+  /**\brief Offset of the first scalar, relative to the start of the file */
+  std::uint64_t dataOffset;
+};
+
+/**\brief Hash cache key
+ *
+ * Calculates the 64-bit FNV-1a hash of a cache key, which is used to name
+ * the corresponding cache file.
+ *
+ * \param[in] key The key to hash.
+ *
+ * \returns The FNV-1a hash of the key.
+ */
+static inline std::uint64_t hash(const std::string &key) {
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (const char &c : key) {
+    h ^= std::uint64_t((unsigned char)c);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+/**\brief Get cache file name
+ *
+ * Constructs the name of the file that geometry with the given key would be
+ * stored in.
+ *
+ * \param[in] directory The cache directory.
+ * \param[in] key       The cache key.
+ *
+ * \returns The full path to the cache file.
+ */
+static inline std::string file(const std::string &directory,
+                               const std::string &key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%016llx.tgc",
+                (unsigned long long)hash(key));
+  return directory + name;
+}
+
+/**\brief Load geometry from cache
+ *
+ * Maps the cache file for the given key into memory and, if the file matches
+ * the key and layout, passes its scalars to the given function while they
+ * are still mapped, so the caller can copy them straight to where they are
+ * needed. The file's modification time is updated on a hit, which is what
+ * eviction is based on.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam F Function type; called with a pointer to the scalars of all the
+ *           faces and the number of faces.
+ *
+ * \param[in] directory    The cache directory.
+ * \param[in] key          The cache key.
+ * \param[in] dimensions   Number of dimensions per vertex.
+ * \param[in] faceVertices Number of vertices per face.
+ * \param[in] copy         The function to pass the scalars to on a hit.
+ *
+ * \returns 'true' on a cache hit, 'false' otherwise.
+ */
+template <typename Q, typename F>
+static bool load(const std::string &directory, const std::string &key,
+                 std::size_t dimensions, std::size_t faceVertices, F copy) {
+  const std::string name = file(directory, key);
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || (std::size_t(st.st_size) < sizeof(header))) {
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const char *bytes = (const char *)map;
+  const header &h = *(const header *)map;
+  const std::size_t size = std::size_t(st.st_size);
+  bool hit =
+      (std::memcmp(h.magic, "TOPOGEO", 8) == 0) &&
+      (h.byteOrder == 0x01020304) && (h.version == 1) &&
+      (h.scalarSize == sizeof(Q)) && (h.dimensions == dimensions) &&
+      (h.faceVertices == faceVertices) && (h.keyLength == key.size()) &&
+      (sizeof(header) + key.size() <= size) &&
+      (key.compare(0, key.size(), bytes + sizeof(header), key.size()) == 0) &&
+      (h.dataOffset <= size) &&
+      (h.faces * faceVertices * dimensions <= (size - h.dataOffset) / sizeof(Q));
+
+  if (hit) {
+    copy((const Q *)(bytes + h.dataOffset), std::size_t(h.faces));
+  }
+
+  munmap(map, st.st_size);
+
+  if (hit) {
+    utime(name.c_str(), 0);
+  }
+
+  return hit;
+}
+
+/**\brief Create cache directory
+ *
+ * Creates the given directory, along with any of its parents that don't
+ * exist yet.
+ *
+ * \param[in] directory The directory to create.
+ *
+ * \returns 'true' if the directory exists afterwards.
+ */
+static bool create(const std::string &directory) {
+  for (std::size_t i = directory.find('/', 1); i != std::string::npos;
+       i = directory.find('/', i + 1)) {
+    mkdir(directory.substr(0, i).c_str(), 0777);
+  }
+  mkdir(directory.c_str(), 0777);
+
+  struct stat st;
+  return (stat(directory.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+}
+
+/**\brief Evict old cache files
+ *
+ * Deletes the least recently used cache files in the given directory until
+ * the total size of the remaining files is within the given budget.
+ *
+ * \param[in] directory The cache directory.
+ * \param[in] budget    Maximum total size of all cache files, in bytes.
+ *
+ * \returns The number of files that were deleted.
+ */
+static std::size_t evict(const std::string &directory, std::size_t budget) {
+  DIR *dir = opendir(directory.c_str());
+  if (dir == 0) {
+    return 0;
+  }
+
+  std::vector<std::pair<time_t, std::pair<std::size_t, std::string>>> files;
+  std::size_t total = 0;
+
+  while (struct dirent *e = readdir(dir)) {
+    const std::string n = e->d_name;
+    if ((n.size() < 4) || (n.compare(n.size() - 4, 4, ".tgc") != 0)) {
+      continue;
+    }
+
+    struct stat st;
+    const std::string name = directory + "/" + n;
+    if (stat(name.c_str(), &st) == 0) {
+      files.push_back({st.st_mtime, {std::size_t(st.st_size), name}});
+      total += std::size_t(st.st_size);
+    }
+  }
+
+  closedir(dir);
+
+  std::sort(files.begin(), files.end());
+
+  std::size_t deleted = 0;
+  for (const auto &f : files) {
+    if (total <= budget) {
+      break;
+    }
+    if (unlink(f.second.second.c_str()) == 0) {
+      total -= f.second.first;
+      deleted++;
+    }
+  }
+
+  return deleted;
+}
+
+/**\brief Store geometry in cache
+ *
+ * Writes the given geometry to the cache file for the given key, creating
+ * the cache directory if necessary. The data is written to a temporary file
+ * first, which is then renamed, so other
+ * processes never get to see a partially written file. Afterwards, old
+ * files are evicted to keep the cache within its budget.
+ *
+ * \tparam Q Base data type for calculations.
+ *
+ * \param[in] directory    The cache directory.
+ * \param[in] key          The cache key.
+ * \param[in] dimensions   Number of dimensions per vertex.
+ * \param[in] faceVertices Number of vertices per face.
+ * \param[in] data         The scalars of all the faces.
+ * \param[in] budget       Maximum total size of the cache, in bytes.
+ *
+ * \returns 'true' if the geometry was stored successfully.
+ */
+template <typename Q>
+static bool store(const std::string &directory, const std::string &key,
+                  std::size_t dimensions, std::size_t faceVertices,
+                  const std::vector<Q> &data, std::size_t budget) {
+  static std::atomic<unsigned long> serial(0);
+
+  header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, "TOPOGEO", 8);
+  h.byteOrder = 0x01020304;
+  h.version = 1;
+  h.scalarSize = sizeof(Q);
+  h.dimensions = dimensions;
+  h.faceVertices = faceVertices;
+  h.keyLength = key.size();
+  h.faces = data.size() / (dimensions * faceVertices);
+  h.dataOffset = (sizeof(header) + key.size() + 63) / 64 * 64;
+
+  const std::size_t size = h.dataOffset + data.size() * sizeof(Q);
+  if (size > budget) {
+    return false;
+  }
+
+  if (!create(directory)) {
+    return false;
+  }
+
+  const std::string name = file(directory, key);
+  std::ostringstream tmp;
+  tmp << name << "." << getpid() << "." << serial++ << ".tmp";
+
+  std::FILE *f = std::fopen(tmp.str().c_str(), "wb");
+  if (f == 0) {
+    return false;
+  }
+
+  static const char padding[64] = {0};
+  bool ok = (std::fwrite(&h, sizeof(h), 1, f) == 1) &&
+            (std::fwrite(key.data(), 1, key.size(), f) == key.size()) &&
+            (std::fwrite(padding, 1, h.dataOffset - sizeof(h) - key.size(),
+                         f) == h.dataOffset - sizeof(h) - key.size()) &&
+            (std::fwrite(data.data(), sizeof(Q), data.size(), f) ==
+             data.size());
+  ok = (std::fclose(f) == 0) && ok;
+
+  if (!ok || (std::rename(tmp.str().c_str(), name.c_str()) != 0)) {
+    std::remove(tmp.str().c_str());
+    return false;
+  }
+
+  evict(directory, budget);
+
+  return true;
+}
+}
+}
+
+#endif
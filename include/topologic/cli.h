@@ -26,6 +26,9 @@
 #define NO_OPENGL
 
 #include <topologic/arguments.h>
+#include <topologic/batch.h>
+#include <topologic/server.h>
+#include <regex>
 
 #if !defined(MAXDEPTH)
 /**\brief Maximum render depth
@@ -45,6 +48,22 @@ namespace topologic {
  * Main function for a typical CLI-/SVG-only frontend. This is part of the
  * library code so that it's easy to reuse where applicable.
  *
+ * In addition to the regular options, this frontend accepts a "batch" option,
+ * which makes it read a manifest of jobs from stdin or the given file and
+ * render each of them to its own output file. The same state object and
+ * options are used for all of the jobs in a batch, unless the "jobs" option
+ * asks for more than one worker thread, in which case each worker gets its
+ * own state object.
+ *
+ * With the "daemon" option, the frontend keeps running as a
+ * topologic::server instead, which renders requests that it receives over a
+ * Unix domain socket with as many worker threads as the "jobs" option asks
+ * for.
+ *
+ * The "jsonl" option makes the frontend render a stream of JSON state
+ * documents, one per line, to stdout, reading and rendering one document at
+ * a time.
+ *
  * \tparam FP Floating point data type to use; something like double
  *
  * \param[in] argc The number of arguments that are being passed in argv.
@@ -57,30 +76,175 @@ namespace topologic {
 template <typename FP> int cli(int argc, char *argv[]) {
   state<FP, MAXDEPTH> topologicState;
   std::vector<std::string> args;
+  bool batchMode = false;
+  std::string manifest = "";
+  std::size_t threads = 1;
+  bool ordered = false;
+  std::string socketPath = "";
+  bool jsonlMode = false;
+  std::string jsonlFile = "";
+
+  efgy::cli::option obatch("-{0,2}batch(:(.+))?",
+                           [&batchMode, &manifest](std::smatch & m)->bool {
+    batchMode = true;
+    manifest = m[2];
+    return true;
+  },
+                           "Render a batch of jobs, one per line, read from "
+                           "the given manifest file or stdin. Each line is of "
+                           "the form: OUTPUT ARGUMENTS... or OUTPUT {JSON}.");
+
+  efgy::cli::option ojobs("-{0,2}(j|jobs):([0-9]+)",
+                          [&threads](std::smatch & m)->bool {
+    threads = std::stoul(m[2]);
+    return true;
+  },
+                          "Number of worker threads to render a batch with; 0 "
+                          "uses all available hardware threads.");
+
+  efgy::cli::option oordered("-{0,2}ordered", [&ordered](std::smatch &)->bool {
+    ordered = true;
+    return true;
+  },
+                             "Write batch results in the order the jobs were "
+                             "submitted in.");
+
+  efgy::cli::option odaemon("-{0,2}daemon:(.+)",
+                            [&socketPath](std::smatch & m)->bool {
+    socketPath = m[1];
+    return true;
+  },
+                            "Keep running and render requests received on "
+                            "the Unix domain socket at the given path. Each "
+                            "request is a single line of the form: "
+                            "ARGUMENTS... or {JSON}.");
+
+  efgy::cli::option ojsonl("-{0,2}jsonl(:(.+))?",
+                           [&jsonlMode, &jsonlFile](std::smatch & m)->bool {
+    jsonlMode = true;
+    jsonlFile = m[2];
+    return true;
+  },
+                           "Render a stream of JSON state documents, one per "
+                           "line, read from the given file or stdin, to "
+                           "stdout.");
 
   for (std::size_t i = 0; i < argc; i++) {
     args.push_back(argv[i]);
   }
 
-  enum outputMode out = parse(topologicState, args);
+  arguments<FP, MAXDEPTH> options(topologicState);
+  enum outputMode out = options.apply(args);
 
-  if (!topologicState.model) {
-    std::cerr << "error: no model to render\n";
-  } else if (out == outSVG) {
-    std::cout << efgy::svg::tag() << topologicState;
-  } else if (out == outJSON) {
-    std::cout << efgy::json::tag() << topologicState;
-  } else if (out == outArguments) {
-    std::vector<std::string> v;
-    std::cout << "topologic";
-    for (const auto &arg : topologicState.args(v)) {
-      std::cout << " " << arg;
+  if (socketPath != "") {
+    server<FP, MAXDEPTH> s(options, topologicState, threads,
+                           out == outNone ? outSVG : out);
+    return s.run(socketPath) ? 0 : 1;
+  }
+
+  if (jsonlMode) {
+    if (out == outNone) {
+      out = outSVG;
     }
-    std::cout << "\n";
+
+    bool rv;
+    if ((jsonlFile == "") || (jsonlFile == "-")) {
+      rv = jsonLines(options, topologicState, std::cin, out);
+    } else {
+      std::ifstream in(jsonlFile);
+      if (!in) {
+        std::cerr << "error: could not open JSON Lines file " << jsonlFile
+                  << "\n";
+        return 1;
+      }
+      rv = jsonLines(options, topologicState, in, out);
+    }
+
+    if (topologicState.statistics.enabled) {
+      topologicState.statistics.json(std::cerr);
+    }
+
+    return rv ? 0 : 1;
+  }
+
+  if (batchMode) {
+    if (out == outNone) {
+      out = outSVG;
+    }
+
+    bool rv;
+    if ((manifest == "") || (manifest == "-")) {
+      rv = batch(options, topologicState, std::cin, out, threads, ordered);
+    } else {
+      std::ifstream in(manifest);
+      if (!in) {
+        std::cerr << "error: could not open batch manifest " << manifest
+                  << "\n";
+        return 1;
+      }
+      rv = batch(options, topologicState, in, out, threads, ordered);
+    }
+
+    if (topologicState.statistics.enabled) {
+      topologicState.statistics.json(std::cerr);
+    }
+
+    return rv ? 0 : 1;
+  }
+
+  if (out != outNone) {
+    write(std::cout, topologicState, out);
+  } else if (!topologicState.model) {
+    std::cerr << "error: no model to render\n";
+  }
+
+  if (topologicState.statistics.enabled) {
+    topologicState.statistics.json(std::cerr);
   }
 
   return 0;
 }
+
+/**\brief Default CLI frontend main function; runtime data type
+ *
+ * Runs the CLI frontend with floats if the last "numbers" option in the
+ * arguments asks for them, and with doubles otherwise. The "numbers:mixed"
+ * option also uses doubles, but projects batches of vertices as floats.
+ * The frontend is only built with floats if FLOATS is set, as that compiles
+ * all of the models a second time; without it, "numbers:float" is an error.
+ *
+ * Floats are faster, but less precise: the projected coordinates typically
+ * match those calculated with doubles to about six significant digits.
+ *
+ * \param[in] argc The number of arguments that are being passed in argv.
+ * \param[in] argv The actual argument vector.
+ *
+ * \returns 0 if the function ran correctly, nonzero otherwise.
+ */
+static int cli(int argc, char *argv[]) {
+  const std::regex numbers("-{0,2}numbers:(float|double|mixed)");
+  std::smatch m;
+  bool useFloat = false;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (std::regex_match(arg, m, numbers)) {
+      useFloat = (m[1] == "float");
+    }
+  }
+
+#if FLOATS
+  return useFloat ? cli<float>(argc, argv) : cli<double>(argc, argv);
+#else
+  if (useFloat) {
+    std::cerr << "error: this binary was built without numbers:float; "
+                 "rebuild with FLOATS=1\n";
+    return 1;
+  }
+
+  return cli<double>(argc, argv);
+#endif
+}
 }
 
 #endif
@@ -0,0 +1,192 @@
+/**\file
+ * \brief Duplicate face removal
+ *
+ * IFS models with overlapping functions tend to produce the same faces over
+ * and over again at higher iterations. The class in this file recognises
+ * faces that have already been seen, up to a tolerance, so that they don't
+ * have to be written out more than once.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_DEDUP_H)
+#define TOPOLOGIC_DEDUP_H
+
+#include <ef.gy/vector.h>
+#include <topologic/flame.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace topologic {
+/**\brief Duplicate face filter
+ *
+ * Keeps track of the faces that have been seen so far. Each face is reduced
+ * to a key by rounding its coordinates to multiples of a tolerance, and by
+ * starting it at whichever vertex, in whichever direction, gives the
+ * smallest sequence of rounded coordinates, so faces that only differ in
+ * where they start or in their winding are the same. Only 128-bit hashes of
+ * these keys are kept, which makes it very unlikely for two different faces
+ * to be mistaken for each other, but not impossible.
+ *
+ * Rounding means that two vertices that are closer than the tolerance can
+ * still end up with different keys if they happen to be on either side of
+ * a multiple of the tolerance, so not all duplicates are caught.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ */
+template <typename Q, std::size_t n, std::size_t f> class dedup {
+public:
+  /**\brief Face type */
+  using face = std::array<efgy::math::vector<Q, n>, f>;
+
+  /**\brief Construct with tolerance
+   *
+   * \param[in] pTolerance Distance that coordinates are rounded to; must be
+   *                       greater than 0.
+   */
+  dedup(Q pTolerance) : tolerance(pTolerance), removed(0) {}
+
+  /**\brief Add face
+   *
+   * Records the given face as seen. Faces with coordinates that can't be
+   * rounded, e.g. because they aren't finite, are never duplicates.
+   *
+   * \param[in] g The face to add.
+   *
+   * \returns 'true' if the face hadn't been seen before, 'false' if it's a
+   *          duplicate.
+   */
+  bool insert(const face &g) {
+    std::array<std::array<long long, n>, f> q;
+
+    for (std::size_t v = 0; v < f; v++) {
+      for (std::size_t c = 0; c < n; c++) {
+        const Q r = g[v][c] / tolerance;
+        if (!(std::fabs(double(r)) < 9e18)) {
+          return true;
+        }
+        q[v][c] = std::llround(double(r));
+      }
+    }
+
+    std::size_t start = 0;
+    bool reverse = false;
+    for (std::size_t s = 0; s < f; s++) {
+      for (bool r : {false, true}) {
+        if (less(q, s, r, start, reverse)) {
+          start = s;
+          reverse = r;
+        }
+      }
+    }
+
+    std::uint64_t a = 0x243f6a8885a308d3ull, b = 0x13198a2e03707344ull;
+    for (std::size_t i = 0; i < f; i++) {
+      for (std::size_t c = 0; c < n; c++) {
+        const std::uint64_t x = std::uint64_t(q[at(start, reverse, i)][c]);
+        a = flame::random::mix(a ^ x);
+        b = flame::random::mix(b + x * 0x9e3779b97f4a7c15ull);
+      }
+    }
+
+    if (seen.insert(std::make_pair(a, b)).second) {
+      return true;
+    }
+
+    removed++;
+    return false;
+  }
+
+  /**\brief Remove duplicates
+   *
+   * Adds all the given faces and removes those that are duplicates, keeping
+   * the order of the others.
+   *
+   * \param[in,out] faces The faces to filter.
+   */
+  void filter(std::vector<face> &faces) {
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < faces.size(); i++) {
+      if (insert(faces[i])) {
+        faces[j++] = faces[i];
+      }
+    }
+    faces.resize(j);
+  }
+
+  /**\brief Tolerance
+   *
+   * Coordinates are rounded to multiples of this.
+   */
+  const Q tolerance;
+
+  /**\brief Number of duplicates
+   *
+   * The number of faces that were recognised as duplicates so far.
+   */
+  std::size_t removed;
+
+protected:
+  /**\brief Vertex index
+   *
+   * \param[in] start   Index of the vertex to start at.
+   * \param[in] reverse Whether to go through the vertices backwards.
+   * \param[in] i       Position in the sequence.
+   *
+   * \returns The index of the vertex at the given position.
+   */
+  static std::size_t at(std::size_t start, bool reverse, std::size_t i) {
+    return reverse ? (start + f - i) % f : (start + i) % f;
+  }
+
+  /**\brief Compare vertex sequences
+   *
+   * \param[in] q  The rounded coordinates of a face's vertices.
+   * \param[in] s  Start of the first sequence.
+   * \param[in] r  Direction of the first sequence.
+   * \param[in] t  Start of the second sequence.
+   * \param[in] rt Direction of the second sequence.
+   *
+   * \returns 'true' if the first sequence is lexicographically smaller.
+   */
+  static bool less(const std::array<std::array<long long, n>, f> &q,
+                   std::size_t s, bool r, std::size_t t, bool rt) {
+    for (std::size_t i = 0; i < f; i++) {
+      const auto &x = q[at(s, r, i)], &y = q[at(t, rt, i)];
+      if (x != y) {
+        return x < y;
+      }
+    }
+    return false;
+  }
+
+  /**\brief Hash of a key hash
+   *
+   * The key hashes are already well mixed, so either half will do.
+   */
+  struct hash {
+    std::size_t operator()(const std::pair<std::uint64_t, std::uint64_t> &h)
+        const {
+      return std::size_t(h.first);
+    }
+  };
+
+  /**\brief Hashes of the keys of all the faces seen so far */
+  std::unordered_set<std::pair<std::uint64_t, std::uint64_t>, hash> seen;
+};
+}
+
+#endif
@@ -0,0 +1,773 @@
+/**\file
+ * \brief Runtime-dimension models
+ *
+ * All of the regular models and projections have their dimension as a
+ * template parameter, so rendering a model in more dimensions than MAXDEPTH
+ * means recompiling with a larger MAXDEPTH, and the size of the binary grows
+ * with every dimension. The code in this file renders cubes and simplices
+ * with vectors and matrices whose size is only known at runtime instead, so
+ * they can be rendered in any number of dimensions.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_DYNAMIC_H)
+#define TOPOLOGIC_DYNAMIC_H
+
+#include <topologic/state.h>
+#include <topologic/profile.h>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace topologic {
+/**\brief Runtime-dimension models
+ *
+ * Contains the matrices, camera setup and renderer used for models with a
+ * render depth greater than that of the state object.
+ */
+namespace dynamic {
+/**\brief Runtime-sized matrix
+ *
+ * A matrix of Q with any number of rows and columns, stored in a single
+ * contiguous buffer in column-major order. With that layout, both the
+ * matrix-vector and matrix-matrix products are a series of scaled column
+ * additions over contiguous memory, which compilers vectorise without
+ * having to reorder any floating point additions.
+ *
+ * \tparam Q Base data type for calculations.
+ */
+template <typename Q> class matrix {
+public:
+  /**\brief Construct zero matrix
+   *
+   * \param[in] pRows    Number of rows.
+   * \param[in] pColumns Number of columns.
+   */
+  matrix(std::size_t pRows = 0, std::size_t pColumns = 0)
+      : rows(pRows), columns(pColumns), data(pRows * pColumns, Q(0)) {}
+
+  /**\brief Identity matrix
+   *
+   * \param[in] n Number of rows and columns.
+   *
+   * \returns An n by n identity matrix.
+   */
+  static matrix identity(std::size_t n) {
+    matrix m(n, n);
+    for (std::size_t i = 0; i < n; i++) {
+      m(i, i) = Q(1);
+    }
+    return m;
+  }
+
+  /**\brief Access cell
+   *
+   * \param[in] i Row of the cell.
+   * \param[in] j Column of the cell.
+   *
+   * \returns A reference to the cell.
+   */
+  Q &operator()(std::size_t i, std::size_t j) { return data[j * rows + i]; }
+
+  /**\brief Access cell; const variant
+   *
+   * \param[in] i Row of the cell.
+   * \param[in] j Column of the cell.
+   *
+   * \returns The value of the cell.
+   */
+  const Q &operator()(std::size_t i, std::size_t j) const {
+    return data[j * rows + i];
+  }
+
+  /**\brief Matrix product
+   *
+   * \param[in] b The matrix to multiply with; must have as many rows as this
+   *              matrix has columns.
+   *
+   * \returns The product of this matrix and b.
+   */
+  matrix operator*(const matrix &b) const {
+    matrix c(rows, b.columns);
+    for (std::size_t j = 0; j < b.columns; j++) {
+      Q *out = &c.data[j * rows];
+      for (std::size_t k = 0; k < columns; k++) {
+        const Q s = b(k, j);
+        const Q *in = &data[k * rows];
+        for (std::size_t i = 0; i < rows; i++) {
+          out[i] += in[i] * s;
+        }
+      }
+    }
+    return c;
+  }
+
+  /**\brief Apply to vector
+   *
+   * Multiplies the matrix with a column vector.
+   *
+   * \param[in]  in  The vector to multiply; must have 'columns' elements.
+   * \param[out] out Where to write the result to; must have room for 'rows'
+   *                 elements and must not overlap with 'in'.
+   */
+  void apply(const Q *in, Q *out) const {
+    for (std::size_t i = 0; i < rows; i++) {
+      out[i] = Q(0);
+    }
+    for (std::size_t j = 0; j < columns; j++) {
+      const Q s = in[j];
+      const Q *column = &data[j * rows];
+      for (std::size_t i = 0; i < rows; i++) {
+        out[i] += column[i] * s;
+      }
+    }
+  }
+
+  /**\brief Number of rows */
+  std::size_t rows;
+
+  /**\brief Number of columns */
+  std::size_t columns;
+
+  /**\brief Cells, in column-major order */
+  std::vector<Q> data;
+};
+
+/**\brief Projection step
+ *
+ * Creates the matrix that takes a vector in homogeneous coordinates in
+ * n-space to (n-1)-space: the given affine transformation is applied first,
+ * then the camera is moved to 'from', looking at the origin, and finally
+ * the perspective projection is applied. The last element of the result is
+ * the distance from the camera, which the other elements need to be divided
+ * by. Orthographic steps drop the distance and put the homogeneous
+ * coordinate there instead, scaled so that the origin appears the same size
+ * as with a perspective step.
+ *
+ * The camera's basis is found by Gram-Schmidt orthogonalisation of the view
+ * direction and the unit vectors, which is O(n^3), rather than with the
+ * generalised cross products that the fixed-dimension projections use.
+ *
+ * \tparam Q Base data type for calculations.
+ *
+ * \param[in] n              Number of dimensions to project from.
+ * \param[in] from           Camera position, in cartesian coordinates.
+ * \param[in] transformation Affine transformation, (n+1) by (n+1).
+ * \param[in] eyeAngle       Field of view of the camera.
+ * \param[in] orthographic   Whether to use an orthographic projection.
+ *
+ * \returns An n by (n+1) projection matrix.
+ */
+template <typename Q>
+static matrix<Q> step(std::size_t n, const std::vector<Q> &from,
+                      const matrix<Q> &transformation, const Q &eyeAngle,
+                      bool orthographic) {
+  std::vector<std::vector<Q>> basis;
+  std::vector<Q> w(n);
+  Q length = Q(0);
+  for (std::size_t i = 0; i < n; i++) {
+    w[i] = -from[i];
+    length += w[i] * w[i];
+  }
+  length = std::sqrt(length);
+  for (std::size_t i = 0; i < n; i++) {
+    w[i] = length > Q(0) ? w[i] / length : Q(i == n - 1);
+  }
+  basis.push_back(w);
+
+  for (std::size_t k = 0; (k < n) && (basis.size() < n); k++) {
+    std::vector<Q> v(n, Q(0));
+    v[k] = Q(1);
+    for (const auto &b : basis) {
+      Q p = Q(0);
+      for (std::size_t i = 0; i < n; i++) {
+        p += v[i] * b[i];
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        v[i] -= p * b[i];
+      }
+    }
+    Q l = Q(0);
+    for (std::size_t i = 0; i < n; i++) {
+      l += v[i] * v[i];
+    }
+    l = std::sqrt(l);
+    if (l > Q(1e-6)) {
+      for (std::size_t i = 0; i < n; i++) {
+        v[i] /= l;
+      }
+      basis.push_back(v);
+    }
+  }
+
+  const Q f = Q(1) / std::tan(eyeAngle / Q(2));
+  matrix<Q> view(n, n + 1);
+  for (std::size_t r = 0; r < n; r++) {
+    const std::vector<Q> &b = basis[(r + 1) % n];
+    const Q scale = r < n - 1 ? f : Q(1);
+    Q t = Q(0);
+    for (std::size_t i = 0; i < n; i++) {
+      view(r, i) = b[i] * scale;
+      t -= b[i] * from[i];
+    }
+    view(r, n) = t * scale;
+  }
+
+  if (orthographic) {
+    for (std::size_t r = 0; r <= n; r++) {
+      for (std::size_t i = 0; i < n - 1; i++) {
+        view(i, r) /= length;
+      }
+      view(n - 1, r) = Q(r == n);
+    }
+  }
+
+  return view * transformation;
+}
+
+/**\brief Polar to cartesian coordinates
+ *
+ * \tparam Q Base data type for calculations.
+ *
+ * \param[in] polar A vector in polar coordinates: (radius, theta-1, ...).
+ *
+ * \returns The vector in cartesian coordinates.
+ */
+template <typename Q>
+static std::vector<Q> cartesian(const std::vector<Q> &polar) {
+  std::vector<Q> v(polar.size());
+  Q s = polar[0];
+  for (std::size_t i = 0; i + 1 < polar.size(); i++) {
+    v[i] = s * std::cos(polar[i + 1]);
+    s *= std::sin(polar[i + 1]);
+  }
+  v[polar.size() - 1] = s;
+  return v;
+}
+
+/**\brief Copy cameras from state object; 2D fix point
+ *
+ * There's no camera in 2D, only the final transformation matrix.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Number of dimensions; ignored.
+ *
+ * \param[in]  s              The state object to copy from.
+ * \param[out] transformation Transformation matrices, indexed by dimension.
+ */
+template <typename Q, std::size_t d>
+static void cameras(const state<Q, 2> &s, std::vector<std::vector<Q>> &,
+                    std::vector<matrix<Q>> &transformation,
+                    std::vector<bool> &) {
+  transformation[2] = matrix<Q>(3, 3);
+  for (std::size_t i = 0; i <= 2; i++) {
+    for (std::size_t j = 0; j <= 2; j++) {
+      transformation[2](i, j) = s.transformation.matrix[j][i];
+    }
+  }
+}
+
+/**\brief Copy cameras from state object
+ *
+ * Copies the camera position and transformation matrix of each dimension of
+ * the state object, recursively, so that they apply to runtime-dimension
+ * models as well. libefgy's affine transformations multiply row vectors from
+ * the left, so the matrices are transposed along the way.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Render depth of the state object.
+ *
+ * \param[in]  s              The state object to copy from.
+ * \param[out] from           Camera positions, indexed by dimension.
+ * \param[out] transformation Transformation matrices, indexed by dimension.
+ * \param[out] orthographic   Projection modes, indexed by dimension.
+ */
+template <typename Q, std::size_t d>
+static void cameras(const state<Q, d> &s, std::vector<std::vector<Q>> &from,
+                    std::vector<matrix<Q>> &transformation,
+                    std::vector<bool> &orthographic) {
+  const efgy::math::vector<Q, d> f = s.getFrom();
+  orthographic[d] = s.orthographic;
+  from[d].resize(d);
+  for (std::size_t i = 0; i < d; i++) {
+    from[d][i] = f[i];
+  }
+  transformation[d] = matrix<Q>(d + 1, d + 1);
+  for (std::size_t i = 0; i <= d; i++) {
+    for (std::size_t j = 0; j <= d; j++) {
+      transformation[d](i, j) = s.transformation.matrix[j][i];
+    }
+  }
+  cameras<Q, d - 1>(s, from, transformation, orthographic);
+}
+
+/**\brief Runtime-dimension model renderer
+ *
+ * Renders a cube or simplex of any depth in any number of dimensions. Camera
+ * positions and transformations for the dimensions that the state object
+ * has are taken from there; the higher dimensions use the same default
+ * camera position that the state object would, and no transformation.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Render depth of the state object.
+ */
+template <typename Q, std::size_t d> class renderer : public render::base {
+public:
+  /**\brief Global state type */
+  using stateType = state<Q, d>;
+
+  /**\brief Construct with state and model
+   *
+   * \param[in,out] pState       The global topologic::state instance
+   * \param[in]     pID          Model ID; "cube" or "simplex".
+   * \param[in]     pDepth       Model depth.
+   * \param[in]     pRenderDepth Render depth; greater than d.
+   */
+  renderer(stateType &pState, const char *pID, std::size_t pDepth,
+           std::size_t pRenderDepth)
+      : render::base(pDepth, pRenderDepth, pID, "cartesian"), gState(pState),
+        faceVertices(std::string(pID) == "cube" ? 4 : 3), radius(0),
+        prepared(false) {}
+
+  /**\brief Supported model
+   *
+   * \param[in] type A model ID.
+   *
+   * \returns The static ID string of the model if it is supported, 0
+   *          otherwise.
+   */
+  static const char *supported(const std::string &type) {
+    return type == "cube" ? "cube" : (type == "simplex" ? "simplex" : 0);
+  }
+
+  /**\brief Get model geometry
+   *
+   * Generates the faces of the model, if they haven't been generated yet
+   * or if the model has been told to update itself. Vertices are stored one
+   * after the other, renderDepth coordinates each, faceVertices vertices
+   * per face.
+   *
+   * \returns The vertices of all the faces.
+   */
+  const std::vector<Q> &geometry(void) {
+    if (metadata::update || (radius != gState.parameter.radius)) {
+      metadata::update = false;
+      radius = gState.parameter.radius;
+      vertices.clear();
+
+      gState.statistics.time("geometry", [this]() {
+        if (faceVertices == 4) {
+          cube();
+        } else {
+          simplex();
+        }
+      });
+
+      const std::size_t n = vertices.size() / renderDepth;
+      gState.statistics.faces += n / faceVertices;
+      gState.statistics.vertices += n;
+    }
+
+    return vertices;
+  }
+
+  bool svg(std::ostream &output, bool updateMatrix = false) {
+    setup(updateMatrix);
+    render::prologue(output, gState, metadata::name());
+    if (gState.surface.alpha > Q(0.)) {
+      if (faceVertices == 4) {
+        paths<4>(output);
+      } else {
+        paths<3>(output);
+      }
+    }
+    output << "</svg>\n";
+
+    return true;
+  }
+
+  bool svg(sink &output, bool updateMatrix = false) {
+    std::ostringstream header;
+    setup(updateMatrix);
+    render::prologue(header, gState, metadata::name());
+    output << header.str();
+    if (gState.surface.alpha > Q(0.)) {
+      if (faceVertices == 4) {
+        paths<4>(output);
+      } else {
+        paths<3>(output);
+      }
+    }
+    output << "</svg>\n";
+
+    return output.flush();
+  }
+
+  bool mesh(std::ostream &output, bool updateMatrix = false,
+            bool source = false) {
+    const std::size_t e = renderDepth;
+    const std::size_t f = faceVertices;
+    const std::size_t width = sizeof(Q) == 4 ? 4 : 8;
+
+    setup(updateMatrix);
+
+    const std::vector<Q> &v = geometry();
+    const std::size_t n = v.size() / e;
+    binary out(output);
+
+    out.integer('T', 1).integer('M', 1).integer('S', 1).integer('H', 1);
+    out.integer(1, 4).integer(n, 8).integer(f, 4);
+    out.integer(source ? 2 + e : 2, 4).integer(source ? e : 0, 4);
+    out.integer(width, 4);
+
+    for (std::size_t i = 0; i < n; i++) {
+      Q x, y;
+      project(&v[i * e], x, y);
+      out.real(x, width).real(y, width);
+      if (source) {
+        for (std::size_t k = 0; k < e; k++) {
+          out.real(v[i * e + k], width);
+        }
+      }
+    }
+
+    return out.flush();
+  }
+
+  bool raster(std::ostream &output, bool updateMatrix = false,
+              bool png = false) {
+    const std::size_t e = renderDepth;
+    const std::size_t f = faceVertices;
+
+    setup(updateMatrix);
+
+    framebuffer image(gState.rasterWidth, gState.rasterHeight,
+                      render::rasterColour(gState.background));
+    const double scale = double(std::min(image.width, image.height)) / 2.4;
+    const double cx = double(image.width) / 2., cy = double(image.height) / 2.;
+    const double stroke = std::max(1., 0.002 * scale);
+
+    if (gState.surface.alpha > Q(0.)) {
+      const framebuffer::colour surface = render::rasterColour(gState.surface);
+      const framebuffer::colour wireframe =
+          render::rasterColour(gState.wireframe);
+      const std::vector<Q> &v = geometry();
+      std::vector<double> x(f), y(f);
+
+      for (std::size_t n = 0; n < v.size(); n += e * f) {
+        for (std::size_t i = 0; i < f; i++) {
+          Q px, py;
+          project(&v[n + i * e], px, py);
+          x[i] = cx + double(px) * scale;
+          y[i] = cy + double(py) * scale;
+        }
+        for (std::size_t i = 2; i < f; i++) {
+          image.triangle({{x[0], x[i - 1], x[i]}}, {{y[0], y[i - 1], y[i]}},
+                         surface);
+        }
+        for (std::size_t i = 0; i < f; i++) {
+          image.line(x[i], y[i], x[(i + 1) % f], y[(i + 1) % f], stroke,
+                     wireframe);
+        }
+      }
+    }
+
+    image.render();
+
+    return png ? image.png(output) : image.ppm(output);
+  }
+
+  bool points(std::ostream &, bool = false, bool = false) {
+    std::cerr << "error: point clouds can only be made of IFS models\n";
+    return false;
+  }
+
+#if !defined(NO_OPENGL)
+  bool opengl(bool = false) {
+    std::cerr << "error: models with more than " << d
+              << " dimensions can't be rendered with OpenGL\n";
+    return false;
+  }
+#endif
+
+protected:
+  /**\brief Update projection matrices
+   *
+   * Updates the state object's matrices, if requested, and recreates the
+   * projection steps from its cameras. The steps are also created the first
+   * time anything is rendered.
+   *
+   * \param[in] updateMatrix Whether to update the projection matrices.
+   */
+  void setup(bool updateMatrix) {
+    if (!updateMatrix && prepared) {
+      return;
+    }
+
+    gState.statistics.time("updateMatrix", [this, updateMatrix]() {
+      if (updateMatrix) {
+        gState.width = 3;
+        gState.height = 3;
+        gState.updateMatrix();
+      }
+
+      std::vector<std::vector<Q>> from(renderDepth + 1);
+      std::vector<matrix<Q>> transformation(renderDepth + 1);
+      std::vector<bool> orthographic(renderDepth + 1, false);
+      cameras<Q, d>(gState, from, transformation, orthographic);
+
+      for (std::size_t n = d + 1; n <= renderDepth; n++) {
+        std::vector<Q> polar(n, Q(1.57));
+        polar[0] = Q(2);
+        from[n] = cartesian(polar);
+        transformation[n] = matrix<Q>::identity(n + 1);
+      }
+
+      steps.clear();
+      for (std::size_t n = renderDepth; n >= 3; n--) {
+        steps.push_back(step(n, from[n], transformation[n], Q(M_PI_4),
+                             orthographic[n]));
+      }
+      plane = transformation[2];
+      buffer.resize(2 * (renderDepth + 1));
+    });
+
+    prepared = true;
+  }
+
+  /**\brief Project vertex to 2D
+   *
+   * \param[in]  v A vertex with renderDepth coordinates.
+   * \param[out] x Projected X coordinate.
+   * \param[out] y Projected Y coordinate.
+   */
+  void project(const Q *v, Q &x, Q &y) {
+    Q *a = &buffer[0], *b = &buffer[renderDepth + 1];
+    for (std::size_t i = 0; i < renderDepth; i++) {
+      a[i] = v[i];
+    }
+    a[renderDepth] = Q(1);
+
+    for (const auto &m : steps) {
+      const std::size_t n = m.rows;
+      m.apply(a, b);
+      Q z = b[n - 1];
+      if (std::fabs(z) < Q(1e-9)) {
+        z = Q(1e-9);
+      }
+      for (std::size_t i = 0; i < n - 1; i++) {
+        a[i] = b[i] / z;
+      }
+      a[n - 1] = Q(1);
+    }
+
+    const Q w = plane(2, 0) * a[0] + plane(2, 1) * a[1] + plane(2, 2);
+    x = (plane(0, 0) * a[0] + plane(0, 1) * a[1] + plane(0, 2)) / w;
+    y = (plane(1, 0) * a[0] + plane(1, 1) * a[1] + plane(1, 2)) / w;
+  }
+
+  /**\brief Write SVG paths
+   *
+   * \tparam f Number of vertices per face.
+   * \tparam S Output type; std::ostream or topologic::sink.
+   *
+   * \param[out] output Where to write the faces to.
+   */
+  template <std::size_t f, typename S> void paths(S &output) {
+    const std::size_t e = renderDepth;
+    const std::vector<Q> &v = geometry();
+    std::array<efgy::math::vector<Q, 2>, f> p;
+
+    for (std::size_t n = 0; n < v.size(); n += e * f) {
+      for (std::size_t i = 0; i < f; i++) {
+        project(&v[n + i * e], p[i][0], p[i][1]);
+      }
+      write(output, p);
+    }
+  }
+
+  /**\brief Write SVG path to stream
+   *
+   * \tparam f Number of vertices per face.
+   *
+   * \param[out] output The stream to write to.
+   * \param[in]  p      The projected vertices of the face.
+   */
+  template <std::size_t f>
+  static void write(std::ostream &output,
+                    const std::array<efgy::math::vector<Q, 2>, f> &p) {
+    render::path<Q, f>(output, p);
+  }
+
+  /**\brief Write SVG path to sink
+   *
+   * \tparam f Number of vertices per face.
+   *
+   * \param[out] output The sink to write to.
+   * \param[in]  p      The projected vertices of the face.
+   */
+  template <std::size_t f>
+  static void write(sink &output,
+                    const std::array<efgy::math::vector<Q, 2>, f> &p) {
+    output.path(p);
+  }
+
+  /**\brief Generate cube
+   *
+   * Generates all the square faces of a cube with an edge length of the
+   * state's radius: one face for each pair of axes and each combination of
+   * signs of the remaining axes.
+   */
+  void cube(void) {
+    const std::size_t e = renderDepth;
+    const Q h = radius / Q(2);
+    const std::size_t others = depth - 2;
+
+    for (std::size_t a = 0; a < depth; a++) {
+      for (std::size_t b = a + 1; b < depth; b++) {
+        for (std::size_t s = 0; s < (std::size_t(1) << others); s++) {
+          std::vector<Q> corner(e, Q(0));
+          for (std::size_t i = 0, k = 0; i < depth; i++) {
+            if ((i != a) && (i != b)) {
+              corner[i] = (s >> k++) & 1 ? h : -h;
+            }
+          }
+          static const int square[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+          for (const auto &q : square) {
+            corner[a] = Q(q[0]) * h;
+            corner[b] = Q(q[1]) * h;
+            vertices.insert(vertices.end(), corner.begin(), corner.end());
+          }
+        }
+      }
+    }
+  }
+
+  /**\brief Generate simplex
+   *
+   * Generates all the triangular faces of a regular simplex, centred on the
+   * origin, with its vertices at a distance of the state's radius from the
+   * origin.
+   */
+  void simplex(void) {
+    const std::size_t e = renderDepth;
+    std::vector<std::vector<Q>> corners(depth + 1, std::vector<Q>(e, Q(0)));
+    const Q last = (Q(1) - std::sqrt(Q(depth + 1))) / Q(depth);
+
+    for (std::size_t i = 0; i < depth; i++) {
+      corners[i][i] = Q(1);
+      corners[depth][i] = last;
+    }
+
+    std::vector<Q> centre(e, Q(0));
+    for (const auto &c : corners) {
+      for (std::size_t i = 0; i < depth; i++) {
+        centre[i] += c[i] / Q(depth + 1);
+      }
+    }
+    for (auto &c : corners) {
+      Q l = Q(0);
+      for (std::size_t i = 0; i < depth; i++) {
+        c[i] -= centre[i];
+        l += c[i] * c[i];
+      }
+      l = std::sqrt(l);
+      for (std::size_t i = 0; i < depth; i++) {
+        c[i] *= radius / l;
+      }
+    }
+
+    for (std::size_t a = 0; a <= depth; a++) {
+      for (std::size_t b = a + 1; b <= depth; b++) {
+        for (std::size_t c = b + 1; c <= depth; c++) {
+          for (std::size_t i : {a, b, c}) {
+            vertices.insert(vertices.end(), corners[i].begin(),
+                            corners[i].end());
+          }
+        }
+      }
+    }
+  }
+
+  /**\brief Global state object */
+  stateType &gState;
+
+  /**\brief Number of vertices per face */
+  const std::size_t faceVertices;
+
+  /**\brief Radius the geometry was generated with */
+  Q radius;
+
+  /**\brief Vertices of all the faces */
+  std::vector<Q> vertices;
+
+  /**\brief Projection steps, from renderDepth down to 3 dimensions */
+  std::vector<matrix<Q>> steps;
+
+  /**\brief Final 2D transformation */
+  matrix<Q> plane;
+
+  /**\brief Scratch space for projecting vertices */
+  std::vector<Q> buffer;
+
+  /**\brief Have the projection steps been created? */
+  bool prepared;
+};
+
+/**\brief Create runtime-dimension model
+ *
+ * Sets the state object's model to a runtime-dimension model, which is
+ * used for render depths that are greater than that of the state object.
+ * An existing model of the same type, depth and render depth is kept and
+ * told to update itself instead.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Render depth of the state object.
+ *
+ * \param[out] s      The state object to update.
+ * \param[in]  format Vector coordinate format; only "cartesian" is
+ *                    supported.
+ * \param[in]  type   Model type; "cube" or "simplex".
+ * \param[in]  depth  Model depth.
+ * \param[in]  rdepth Render depth.
+ *
+ * \returns 'true' if the state object has a model afterwards.
+ */
+template <typename Q, std::size_t d>
+static bool create(state<Q, d> &s, const std::string &format,
+                   const std::string &type, std::size_t depth,
+                   std::size_t rdepth) {
+  const char *id = renderer<Q, d>::supported(type);
+
+  if (!id || (format != "cartesian") || !profile::model(id) || (depth < 2) ||
+      (depth > rdepth)) {
+    std::cerr << "error: only cartesian cubes and simplices with a depth of "
+                 "at least 2 and at most their render depth are available "
+                 "in more than " << d << " dimensions\n";
+    return s.model != 0;
+  }
+
+  if (s.model && (s.model->depth == depth) &&
+      (s.model->renderDepth == rdepth) && (std::string(s.model->id) == id) &&
+      (std::string(s.model->formatID) == format)) {
+    s.model->update = true;
+    return true;
+  }
+
+  delete s.model;
+  s.model = new renderer<Q, d>(s, id, depth, rdepth);
+
+  return s.model != 0;
+}
+}
+}
+
+#endif
@@ -0,0 +1,345 @@
+/**\file
+ * \brief CPU fractal flame renderer
+ *
+ * The fractal flame colouring algorithm used to be only available in the
+ * OpenGL renderer. The code in this file implements it on the CPU instead,
+ * by playing the chaos game with an IFS model's functions and accumulating
+ * the results in a histogram, which is then tone mapped into a
+ * topologic::framebuffer. This works without a GPU, so it can be used on
+ * headless render nodes.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ * \see http://flam3.com/flame_draves.pdf for the original paper describing
+ *      the algorithm.
+ */
+
+#if !defined(TOPOLOGIC_FLAME_H)
+#define TOPOLOGIC_FLAME_H
+
+#include <ef.gy/vector.h>
+#include <topologic/raster.h>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace topologic {
+/**\brief Fractal flame rendering
+ *
+ * Contains the chaos game and the histogram and random number generator
+ * that it uses.
+ */
+namespace flame {
+/**\brief Counter-based random number generator
+ *
+ * Each number is a hash of a key and a counter, using the SplitMix64 mixing
+ * function. Unlike with a conventional generator, independent streams for
+ * parallel workers are simply a matter of using different keys, and the
+ * output of each stream doesn't depend on how the work was scheduled.
+ */
+class random {
+public:
+  /**\brief Construct with key
+   *
+   * \param[in] pKey The key that selects the stream of numbers.
+   */
+  random(std::uint64_t pKey) : key(pKey), counter(0) {}
+
+  /**\brief Next integer
+   *
+   * \returns The next 64-bit number in the stream.
+   */
+  std::uint64_t operator()(void) {
+    return mix(key + (++counter) * 0x9e3779b97f4a7c15ull);
+  }
+
+  /**\brief Next real number
+   *
+   * \returns The next number in the stream, as a value in [0,1).
+   */
+  double real(void) {
+    return double((*this)() >> 11) * (1. / 9007199254740992.);
+  }
+
+  /**\brief Mix value
+   *
+   * The SplitMix64 finaliser; also useful to derive keys for streams.
+   *
+   * \param[in] z The value to mix.
+   *
+   * \returns A hash of the value.
+   */
+  static std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+protected:
+  /**\brief Stream key */
+  const std::uint64_t key;
+
+  /**\brief Number of values generated so far */
+  std::uint64_t counter;
+};
+
+/**\brief Histogram bin
+ *
+ * Number of samples that landed in a pixel, and the sum of their colour
+ * indices. The bins are shared by all threads, so both are atomic, and the
+ * colour indices are summed in fixed point, with 24 fractional bits, so
+ * that the sums don't depend on the order the samples were added in.
+ */
+struct bin {
+  /**\brief Fixed point scale of colour indices */
+  static constexpr double scale = double(1 << 24);
+
+  /**\brief Number of samples */
+  std::atomic<std::uint64_t> count;
+
+  /**\brief Sum of colour indices, times scale */
+  std::atomic<std::uint64_t> colour;
+};
+
+/**\brief Detect IFS models
+ *
+ * Set to std::true_type if the model type M has a 'functions' member, i.e.
+ * if it's an iterated function system that the chaos game can be played
+ * with.
+ *
+ * \tparam M The model type to check.
+ */
+template <typename M, typename = void> struct isIFS : std::false_type {};
+
+/**\brief Detect IFS models; positive case
+ *
+ * \tparam M The model type to check.
+ */
+template <typename M>
+struct isIFS<M, decltype((void)std::declval<const M &>().functions)>
+    : std::true_type {};
+
+/**\brief Play the chaos game
+ *
+ * Generates the given range of chunks of samples with the given functions,
+ * on several threads. Each chunk has its own random stream, derived from
+ * the seed and the chunk number, so the samples of a chunk don't depend on
+ * how many threads there are or on which of them generates the chunk.
+ *
+ * Each chunk starts at a random point and applies size randomly chosen
+ * functions to it. The first 20 points are discarded so that the point has
+ * time to converge on the attractor, as are the 20 points after a point
+ * that isn't finite, which restarts the chunk at a new random point. Each
+ * sample also gets a colour index: the average of the previous colour index
+ * and that of the function that was applied, with colour indices evenly
+ * spaced in [0,1].
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions the functions operate in.
+ * \tparam C Container type of the functions.
+ * \tparam V Visitor type; called as visit(worker, chunk, point, colour)
+ *           from several threads, with the number of the thread that
+ *           generated the sample, which is less than 'threads'.
+ *
+ * \param[in] functions The IFS functions to apply.
+ * \param[in] seed      Seed for the random streams.
+ * \param[in] first     Number of the first chunk to generate.
+ * \param[in] count     Number of chunks to generate.
+ * \param[in] size      Number of iterations per chunk.
+ * \param[in] threads   Number of threads to use; 0 to use as many as there
+ *                      are hardware threads.
+ * \param[in] visit     Called with each sample.
+ */
+template <typename Q, std::size_t n, typename C, typename V>
+static void play(const C &functions, std::uint64_t seed, std::size_t first,
+                 std::size_t count, std::size_t size, std::size_t threads,
+                 const V &visit) {
+  const std::size_t k = functions.size();
+
+  if (k == 0) {
+    return;
+  }
+
+  std::atomic<std::size_t> next(0);
+  auto work = [&](std::size_t worker) {
+    for (std::size_t c = next++; c < count; c = next++) {
+      random rng(random::mix(seed ^ random::mix(first + c + 1)));
+      efgy::math::vector<Q, n> p;
+      double colour = rng.real();
+      std::size_t warmup = 20;
+
+      for (std::size_t i = 0; i < n; i++) {
+        p[i] = Q(rng.real() * 2. - 1.);
+      }
+
+      for (std::size_t s = 0; s < size; s++) {
+        const std::size_t f = std::size_t(rng() % k);
+        p = functions[f] * p;
+        colour = (colour + (k > 1 ? double(f) / double(k - 1) : 0.)) / 2.;
+
+        bool finite = true;
+        for (std::size_t i = 0; i < n; i++) {
+          finite = finite && std::isfinite(double(p[i]));
+        }
+        if (!finite) {
+          for (std::size_t i = 0; i < n; i++) {
+            p[i] = Q(rng.real() * 2. - 1.);
+          }
+          warmup = 20;
+          continue;
+        }
+        if (warmup > 0) {
+          warmup--;
+          continue;
+        }
+
+        visit(worker, first + c, p, colour);
+      }
+    }
+  };
+
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  threads = std::max<std::size_t>(1, std::min(threads, count));
+  std::vector<std::thread> pool;
+  for (std::size_t t = 1; t < threads; t++) {
+    pool.emplace_back(work, t);
+  }
+  work(0);
+  for (auto &t : pool) {
+    t.join();
+  }
+}
+
+/**\brief Render fractal flame
+ *
+ * Plays the chaos game with the given functions and tone maps the result
+ * into the given image. Samples are generated with play(), in rounds of 64
+ * chunks of 65536 iterations each, and all threads accumulate into a single
+ * histogram, so the memory needed doesn't grow with the number of threads.
+ * The histogram doesn't depend on the number of threads either.
+ *
+ * After every round the tone mapped image is compared to that of the round
+ * before, and sampling stops once the mean change per pixel drops below
+ * half of an 8-bit colour step, or once there have been 256 samples per
+ * pixel. If a number of samples is given, sampling stops once there have
+ * been that many iterations instead, rounded up to whole chunks.
+ *
+ * The colour of a pixel is interpolated between 'from' and 'to' by the
+ * average colour index of its samples, and its opacity is the log of its
+ * sample count relative to that of the densest pixel.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions the functions operate in.
+ * \tparam C Container type of the functions.
+ * \tparam P Projection functor type.
+ *
+ * \param[in,out] image     The image to draw into.
+ * \param[in]     functions The IFS functions to apply.
+ * \param[in]     project   Projects a vector to pixel coordinates; called
+ *                          as project(v, x, y) from several threads.
+ * \param[in]     seed      Seed for the random streams.
+ * \param[in]     from      Colour for a colour index of 0.
+ * \param[in]     to        Colour for a colour index of 1.
+ * \param[in]     count     Number of iterations; 0 to stop once the image
+ *                          no longer changes.
+ * \param[in]     threads   Number of threads; 0 to use as many as there
+ *                          are hardware threads.
+ *
+ * \returns The number of samples that were generated.
+ */
+template <typename Q, std::size_t n, typename C, typename P>
+static std::uint64_t render(framebuffer &image, const C &functions,
+                            const P &project, std::uint64_t seed,
+                            const framebuffer::colour &from,
+                            const framebuffer::colour &to,
+                            std::uint64_t count = 0, std::size_t threads = 0) {
+  const std::size_t k = functions.size();
+  const std::size_t pixels = image.width * image.height;
+  const std::size_t chunk = 1 << 16;
+  const std::size_t chunks = 64;
+  const std::uint64_t limit = count > 0 ? count : std::uint64_t(pixels) * 256;
+  const double tolerance = 0.5 / 255.;
+
+  if ((k == 0) || (pixels == 0)) {
+    return 0;
+  }
+
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  threads = std::max<std::size_t>(1, std::min(threads, chunks));
+
+  std::vector<bin> histogram(pixels);
+  std::vector<float> alpha(pixels, 0.f), previous(pixels, 0.f);
+  std::uint64_t samples = 0;
+
+  for (std::size_t round = 0; samples < limit; round++) {
+    const std::size_t c =
+        count > 0 ? std::size_t(std::min<std::uint64_t>(
+                        chunks, (limit - samples + chunk - 1) / chunk))
+                  : chunks;
+
+    play<Q, n>(functions, seed, round * chunks, c, chunk, threads,
+               [&](std::size_t, std::size_t, const efgy::math::vector<Q, n> &p,
+                   double colour) {
+      double x, y;
+      project(p, x, y);
+      if ((x >= 0.) && (y >= 0.) && (x < double(image.width)) &&
+          (y < double(image.height))) {
+        bin &b = histogram[std::size_t(y) * image.width + std::size_t(x)];
+        b.count.fetch_add(1, std::memory_order_relaxed);
+        b.colour.fetch_add(std::uint64_t(colour * bin::scale + .5),
+                           std::memory_order_relaxed);
+      }
+    });
+    samples += chunk * c;
+
+    std::uint64_t densest = 0;
+    for (const auto &b : histogram) {
+      densest = std::max(densest, b.count.load());
+    }
+
+    double change = 0.;
+    const double scale = densest > 0 ? 1. / std::log1p(double(densest)) : 0.;
+    for (std::size_t i = 0; i < pixels; i++) {
+      alpha[i] = float(std::log1p(double(histogram[i].count)) * scale);
+      change += std::fabs(double(alpha[i] - previous[i]));
+    }
+    std::swap(alpha, previous);
+
+    if ((count == 0) && (round > 0) &&
+        (change / double(pixels) < tolerance)) {
+      break;
+    }
+  }
+
+  for (std::size_t i = 0; i < pixels; i++) {
+    const std::uint64_t hits = histogram[i].count;
+    if ((hits == 0) || !(previous[i] > 0.f)) {
+      continue;
+    }
+    const float t = float(double(histogram[i].colour) /
+                          (bin::scale * double(hits)));
+    image.point(i % image.width, i / image.width,
+                {{from[0] + (to[0] - from[0]) * t,
+                  from[1] + (to[1] - from[1]) * t,
+                  from[2] + (to[2] - from[2]) * t, previous[i]}});
+  }
+
+  return samples;
+}
+}
+}
+
+#endif
@@ -0,0 +1,532 @@
+/**\file
+ * \brief Parallel IFS expansion
+ *
+ * The number of faces of an iterated function system grows exponentially
+ * with the number of iterations, and libefgy generates all of them on a
+ * single thread. The code in this file expands an IFS on all available
+ * threads instead, producing exactly the same faces in exactly the same
+ * order, so the output of a model doesn't depend on how many threads were
+ * used to generate it.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_IFS_H)
+#define TOPOLOGIC_IFS_H
+
+#include <ef.gy/vector.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace topologic {
+/**\brief Iterated function systems
+ *
+ * Contains the parallel expansion of IFS models.
+ */
+namespace ifs {
+/**\brief Expansion order
+ *
+ * Each iteration of an IFS applies every function to every face of the
+ * previous iteration; these are the two orders the results can be in.
+ */
+enum order {
+  /**\brief All faces for the first function, then for the second, etc. */
+  functionMajor,
+
+  /**\brief All functions for the first face, then for the second, etc. */
+  faceMajor
+};
+
+/**\brief Run function in parallel
+ *
+ * Splits the range [0,total) into fixed-size chunks, which are handed out
+ * to the threads as they become idle, and calls the given function with the
+ * start and end of each chunk.
+ *
+ * \tparam F Function type; called with the start and end of a chunk.
+ *
+ * \param[in] total   The size of the range.
+ * \param[in] threads Number of threads to use.
+ * \param[in] f       The function to call for each chunk.
+ */
+template <typename F>
+static void parallel(std::size_t total, std::size_t threads, F f) {
+  const std::size_t chunk = 1 << 12;
+
+  std::atomic<std::size_t> next(0);
+  auto work = [&]() {
+    for (std::size_t c = next++; c * chunk < total; c = next++) {
+      f(c * chunk, std::min(total, (c + 1) * chunk));
+    }
+  };
+
+  threads = std::max<std::size_t>(
+      1, std::min(threads, (total + chunk - 1) / chunk));
+  std::vector<std::thread> pool;
+  for (std::size_t t = 1; t < threads; t++) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (auto &t : pool) {
+    t.join();
+  }
+}
+
+/**\brief Apply IFS functions once
+ *
+ * Applies each of the functions to each of the given faces, in the given
+ * order, with each face written to the position that it would have had in
+ * a serial expansion.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ * \tparam C Container type of the functions.
+ *
+ * \param[in]  in        The faces to apply the functions to.
+ * \param[out] out       The resulting faces.
+ * \param[in]  functions The IFS functions.
+ * \param[in]  o         The order to put the results in.
+ * \param[in]  threads   Number of threads to use.
+ */
+template <typename Q, std::size_t n, std::size_t f, typename C>
+static void step(const std::vector<std::array<efgy::math::vector<Q, n>, f>> &in,
+                 std::vector<std::array<efgy::math::vector<Q, n>, f>> &out,
+                 const C &functions, order o, std::size_t threads) {
+  const std::size_t k = functions.size();
+  const std::size_t size = in.size();
+
+  out.resize(size * k);
+
+  parallel(out.size(), threads, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++) {
+      const std::size_t fn = o == functionMajor ? i / size : i % k;
+      const std::size_t j = o == functionMajor ? i % size : i / k;
+      for (std::size_t v = 0; v < f; v++) {
+        out[i][v] = functions[fn] * in[j][v];
+      }
+    }
+  });
+}
+
+/**\brief Compare faces
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ *
+ * \param[in] a The first set of faces.
+ * \param[in] b The second set of faces.
+ *
+ * \returns 'true' if both sets have exactly the same faces, in the same
+ *          order.
+ */
+template <typename Q, std::size_t n, std::size_t f>
+static bool same(const std::vector<std::array<efgy::math::vector<Q, n>, f>> &a,
+                 const std::vector<std::array<efgy::math::vector<Q, n>, f>> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < a.size(); i++) {
+    for (std::size_t v = 0; v < f; v++) {
+      for (std::size_t c = 0; c < n; c++) {
+        if (!(a[i][v][c] == b[i][v][c])) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+/**\brief Check memory budget
+ *
+ * \param[in] count  Number of objects.
+ * \param[in] size   Size of each object, in bytes.
+ * \param[in] memory Memory budget in bytes; 0 for no limit.
+ *
+ * \returns 'true' if the objects fit into the budget.
+ */
+static bool fits(std::size_t count, std::size_t size, std::size_t memory) {
+  return (memory == 0) || (count <= memory / size);
+}
+
+/**\brief Detect expansion order
+ *
+ * The order that a model generates its faces in isn't part of its
+ * interface, so this function checks which of the known orders, if any,
+ * reproduces the model's own faces for one and two iterations.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ * \tparam C Container type of the functions.
+ *
+ * \param[in]  base      The model's faces after zero iterations.
+ * \param[in]  one       The model's faces after one iteration.
+ * \param[in]  two       The model's faces after two iterations.
+ * \param[in]  functions The IFS functions.
+ * \param[out] o         The order that the model uses.
+ *
+ * \returns 'true' if the order is known, 'false' otherwise.
+ */
+template <typename Q, std::size_t n, std::size_t f, typename C>
+static bool detect(const std::vector<std::array<efgy::math::vector<Q, n>, f>> &base,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &one,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &two,
+                   const C &functions, order &o) {
+  std::vector<std::array<efgy::math::vector<Q, n>, f>> a, b;
+
+  if ((functions.size() == 0) || base.empty()) {
+    return false;
+  }
+
+  for (order c : {functionMajor, faceMajor}) {
+    step(base, a, functions, c, 1);
+    step(one, b, functions, c, 1);
+    if (same(a, one) && same(b, two)) {
+      o = c;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**\brief Expand IFS
+ *
+ * Expands an IFS to the given number of iterations on several threads. The
+ * caller passes in the model's own faces for zero, one and two iterations,
+ * and the expansion only goes ahead if detect() finds the order that the
+ * model uses; otherwise the caller has to let the model generate its faces
+ * by itself.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ * \tparam C Container type of the functions.
+ *
+ * \param[out] faces      The faces after the given number of iterations.
+ * \param[in]  base       The model's faces after zero iterations.
+ * \param[in]  one        The model's faces after one iteration.
+ * \param[in]  two        The model's faces after two iterations.
+ * \param[in]  functions  The IFS functions.
+ * \param[in]  iterations Number of iterations to expand to.
+ * \param[in]  memory     Maximum number of bytes that the faces may take up
+ *                        at any one time; 0 for no limit.
+ * \param[in]  threads    Number of threads; 0 to use as many as there are
+ *                        hardware threads.
+ *
+ * \returns 'true' if the faces were expanded, 'false' if the model's faces
+ *          are in an order that this function can't reproduce or if they
+ *          wouldn't fit into the given memory.
+ */
+template <typename Q, std::size_t n, std::size_t f, typename C>
+static bool expand(std::vector<std::array<efgy::math::vector<Q, n>, f>> &faces,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &base,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &one,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &two,
+                   const C &functions, std::size_t iterations,
+                   std::size_t memory = 0, std::size_t threads = 0) {
+  std::vector<std::array<efgy::math::vector<Q, n>, f>> a, b;
+  const std::size_t k = functions.size();
+  order o = functionMajor;
+
+  if ((iterations < 2) || !detect(base, one, two, functions, o)) {
+    return false;
+  }
+
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+
+  a = two;
+  for (std::size_t i = 2; i < iterations; i++) {
+    if (!fits(a.size(), sizeof(a[0]) * (k + 1), memory)) {
+      return false;
+    }
+    step(a, b, functions, o, threads);
+    a.swap(b);
+  }
+  faces.swap(a);
+
+  return true;
+}
+
+/**\brief Find invariant box
+ *
+ * Finds an axis-aligned box that contains the given faces and that each of
+ * the functions maps into itself, which means that the box also contains
+ * all the faces of any number of iterations. The box starts out as the
+ * bounding box of the faces and is grown until it's invariant, which only
+ * works if the functions are contractions.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ * \tparam C Container type of the functions.
+ *
+ * \param[in]  faces     The faces to put in the box.
+ * \param[in]  functions The IFS functions.
+ * \param[out] lo        The box's lower corner.
+ * \param[out] hi        The box's upper corner.
+ *
+ * \returns 'true' if an invariant box was found.
+ */
+template <typename Q, std::size_t n, std::size_t f, typename C>
+static bool bound(const std::vector<std::array<efgy::math::vector<Q, n>, f>> &faces,
+                  const C &functions, efgy::math::vector<Q, n> &lo,
+                  efgy::math::vector<Q, n> &hi) {
+  if (faces.empty()) {
+    return false;
+  }
+
+  lo = faces[0][0];
+  hi = faces[0][0];
+  for (const auto &g : faces) {
+    for (std::size_t v = 0; v < f; v++) {
+      for (std::size_t c = 0; c < n; c++) {
+        lo[c] = std::min(lo[c], g[v][c]);
+        hi[c] = std::max(hi[c], g[v][c]);
+      }
+    }
+  }
+
+  Q extent = Q(0);
+  for (std::size_t c = 0; c < n; c++) {
+    extent = std::max(extent, hi[c] - lo[c]);
+  }
+  if (!(extent > Q(0))) {
+    extent = Q(1);
+  }
+  for (std::size_t c = 0; c < n; c++) {
+    if (hi[c] - lo[c] < extent / Q(16)) {
+      lo[c] -= extent / Q(32);
+      hi[c] += extent / Q(32);
+    }
+  }
+
+  for (std::size_t round = 0; round < 64; round++) {
+    efgy::math::vector<Q, n> l = lo, h = hi, corner;
+    bool inside = true;
+
+    for (std::size_t i = 0; i < (std::size_t(1) << n); i++) {
+      for (std::size_t c = 0; c < n; c++) {
+        corner[c] = (i >> c) & 1 ? hi[c] : lo[c];
+      }
+      for (const auto &fn : functions) {
+        const efgy::math::vector<Q, n> p = fn * corner;
+        for (std::size_t c = 0; c < n; c++) {
+          inside = inside && (p[c] >= lo[c]) && (p[c] <= hi[c]);
+          l[c] = std::min(l[c], p[c]);
+          h[c] = std::max(h[c], p[c]);
+        }
+      }
+    }
+
+    if (inside) {
+      return true;
+    }
+
+    for (std::size_t c = 0; c < n; c++) {
+      const Q slack = (h[c] - l[c]) / Q(16);
+      lo[c] = l[c] - slack;
+      hi[c] = h[c] + slack;
+    }
+  }
+
+  return false;
+}
+
+/**\brief Expand IFS with level of detail
+ *
+ * Expands an IFS to at most the given number of iterations, but stops
+ * expanding any part of it once that part is small enough.
+ *
+ * Each part of the expansion is the composition M of the functions that
+ * lead to it, and its faces after any number of further iterations lie
+ * within M applied to the box that bound() finds. That box lies within a
+ * simplex, so they also lie within the convex hull of M applied to that
+ * simplex's corners, which is all the predicate gets to see. M is only ever
+ * known through these images: they determine M, since it's affine, so M
+ * applied to any other point is a weighted sum of them, with the point's
+ * barycentric coordinates relative to the simplex as the weights.
+ *
+ * Parts are expanded one level at a time, on several threads. Once the
+ * predicate accepts a part, M is applied to the model's faces for zero
+ * iterations and the result is added to the output. Faces come out in a
+ * deterministic order, grouped by the iteration that they stopped at. If
+ * the model uses the function-major order and no parts are accepted early,
+ * the faces are the same as the model's, up to rounding errors.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam n Number of dimensions of the vertices.
+ * \tparam f Number of vertices per face.
+ * \tparam C Container type of the functions.
+ * \tparam P Predicate type; called with a std::array of the n+1 corners
+ *           of a part's bounding simplex.
+ *
+ * \param[out] faces      The faces of the expanded model.
+ * \param[in]  base       The model's faces after zero iterations.
+ * \param[in]  one        The model's faces after one iteration.
+ * \param[in]  two        The model's faces after two iterations.
+ * \param[in]  functions  The IFS functions.
+ * \param[in]  iterations Maximum number of iterations to expand to.
+ * \param[in]  finished   Predicate for parts that need no more iterations.
+ * \param[in]  memory     Maximum number of bytes that the faces and parts
+ *                        may take up at any one time; 0 for no limit.
+ * \param[in]  threads    Number of threads; 0 to use as many as there are
+ *                        hardware threads.
+ *
+ * \returns 'true' if the faces were expanded, 'false' if the model doesn't
+ *          use a known order, if there's no invariant box or if the faces
+ *          wouldn't fit into the given memory.
+ */
+template <typename Q, std::size_t n, std::size_t f, typename C, typename P>
+static bool refine(std::vector<std::array<efgy::math::vector<Q, n>, f>> &faces,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &base,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &one,
+                   const std::vector<std::array<efgy::math::vector<Q, n>, f>> &two,
+                   const C &functions, std::size_t iterations, P finished,
+                   std::size_t memory = 0, std::size_t threads = 0) {
+  using vertex = efgy::math::vector<Q, n>;
+  using frame = std::array<vertex, n + 1>;
+  using weights = std::array<Q, n + 1>;
+  const std::size_t k = functions.size();
+  const std::size_t b = base.size();
+  order o = functionMajor;
+  vertex lo, hi;
+
+  std::vector<std::array<vertex, f>> all(base);
+  all.insert(all.end(), one.begin(), one.end());
+  all.insert(all.end(), two.begin(), two.end());
+
+  if (!detect(base, one, two, functions, o) || !bound(all, functions, lo, hi)) {
+    return false;
+  }
+
+  frame root;
+  root.fill(lo);
+  for (std::size_t c = 0; c < n; c++) {
+    root[c + 1][c] += Q(n) * (hi[c] - lo[c]);
+  }
+
+  const auto barycentric = [&](const vertex &p) -> weights {
+    weights w;
+    w[0] = Q(1);
+    for (std::size_t c = 0; c < n; c++) {
+      w[c + 1] = (p[c] - lo[c]) / (Q(n) * (hi[c] - lo[c]));
+      w[0] -= w[c + 1];
+    }
+    return w;
+  };
+
+  const auto apply = [](const frame &m, const weights &w) -> vertex {
+    vertex p;
+    for (std::size_t c = 0; c < n; c++) {
+      p[c] = Q(0);
+      for (std::size_t l = 0; l <= n; l++) {
+        p[c] += w[l] * m[l][c];
+      }
+    }
+    return p;
+  };
+
+  std::vector<std::array<weights, n + 1>> children(k);
+  for (std::size_t j = 0; j < k; j++) {
+    for (std::size_t m = 0; m <= n; m++) {
+      children[j][m] = barycentric(functions[j] * root[m]);
+    }
+  }
+
+  std::vector<std::array<weights, f>> vertices(b);
+  for (std::size_t i = 0; i < b; i++) {
+    for (std::size_t v = 0; v < f; v++) {
+      vertices[i][v] = barycentric(base[i][v]);
+    }
+  }
+
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+
+  std::vector<std::array<vertex, f>> done;
+  std::vector<frame> parts(1, root), next;
+  std::vector<char> flag;
+
+  const auto emit = [&](const std::vector<frame> &from) {
+    const std::size_t offset = done.size();
+    done.resize(offset + from.size() * b);
+    parallel(from.size() * b, threads, [&](std::size_t s, std::size_t e) {
+      for (std::size_t i = s; i < e; i++) {
+        for (std::size_t v = 0; v < f; v++) {
+          done[offset + i][v] = apply(from[i / b], vertices[i % b][v]);
+        }
+      }
+    });
+  };
+
+  for (std::size_t level = 0; level < iterations; level++) {
+    flag.resize(parts.size());
+    parallel(parts.size(), threads, [&](std::size_t s, std::size_t e) {
+      for (std::size_t i = s; i < e; i++) {
+        flag[i] = finished(parts[i]);
+      }
+    });
+
+    std::vector<frame> stop;
+    std::size_t keep = 0;
+    for (std::size_t i = 0; i < parts.size(); i++) {
+      if (flag[i]) {
+        stop.push_back(parts[i]);
+      } else {
+        parts[keep++] = parts[i];
+      }
+    }
+    parts.resize(keep);
+
+    if (!fits(done.size() + stop.size() * b, sizeof(done[0]), memory)) {
+      return false;
+    }
+    emit(stop);
+
+    const std::size_t used = done.size() * sizeof(done[0]);
+    if ((memory > 0) && ((used > memory) || (parts.size() * (k + 1) >
+                                             (memory - used) / sizeof(frame)))) {
+      return false;
+    }
+
+    next.resize(parts.size() * k);
+    parallel(next.size(), threads, [&](std::size_t s, std::size_t e) {
+      for (std::size_t i = s; i < e; i++) {
+        for (std::size_t m = 0; m <= n; m++) {
+          next[i][m] = apply(parts[i / k], children[i % k][m]);
+        }
+      }
+    });
+    parts.swap(next);
+  }
+
+  if (!fits(done.size() + parts.size() * b, sizeof(done[0]), memory)) {
+    return false;
+  }
+  emit(parts);
+  faces.swap(done);
+
+  return true;
+}
+}
+}
+
+#endif
@@ -17,6 +17,8 @@
 #define TOPOLOGIC_PARSE_H
 
 #include <topologic/state.h>
+#include <topologic/profile.h>
+#include <topologic/dynamic.h>
 #include <ef.gy/polytope.h>
 #include <ef.gy/parametric.h>
 #include <ef.gy/ifs.h>
@@ -27,9 +29,16 @@
 #include <libxml/parser.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/xmlreader.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #endif
+#include <algorithm>
+#include <array>
 #include <set>
 #include <sstream>
+#include <type_traits>
 
 namespace topologic {
 /**\brief Model update functor
@@ -75,10 +84,21 @@ public:
   template <class tQ, std::size_t tD>
   using adapted = efgy::geometry::autoAdapt<tQ, e, T<tQ, tD>, format>;
 
+  /**\brief Model renderer type
+   *
+   * The renderer wrapper type that is created by this functor.
+   */
+  using renderer = render::wrapper<Q, d, adapted, format>;
+
   /**\brief Initialise new model
    *
    * Creates a new model and updates the given state object to use the
-   * newly created instance.
+   * newly created instance. If the state object already has a model with
+   * the same type, depth, render depth and vector format, then that model
+   * is kept, along with any geometry it has cached; the model parameters are
+   * shared with the state object anyway, and the renderer notices by itself
+   * when they have changed. Models that aren't part of the build profile
+   * aren't created.
    *
    * \param[out] out The state object to modify.
    * \param[in]  tag The vector format tag instance to use.
@@ -87,18 +107,58 @@ public:
    *          the time the function returns.
    */
   static output apply(argument out, const format &tag) {
+    return create(out, tag,
+                  std::integral_constant<bool, profile::renderDepth(e)>());
+  }
+
+  /**\brief Initialise new model; selected render depth
+   *
+   * Creates the model, unless the build profile doesn't include the model
+   * or its vector format.
+   *
+   * \param[out] out The state object to modify.
+   * \param[in]  tag The vector format tag instance to use.
+   *
+   * \returns 'true' if the state object has a valid model pointer at
+   *          the time the function returns.
+   */
+  static output create(argument out, const format &tag, std::true_type) {
+    if (!profile::model(renderer::modelType::id()) ||
+        !profile::format(renderer::modelType::format::id())) {
+      return pass(out);
+    }
+
+    if (out.model && (out.model->depth == d) && (out.model->renderDepth == e) &&
+        (std::string(out.model->id) == renderer::modelType::id()) &&
+        (std::string(out.model->formatID) ==
+         renderer::modelType::format::id())) {
+      return true;
+    }
+
     if (out.model) {
       delete out.model;
       out.model = 0;
     }
 
-    out.model =
-        (render::base *)(new render::wrapper<Q, d, adapted, format>(
-            out, tag));
+    out.model = (render::base *)(new renderer(out, tag));
 
     return out.model != 0;
   }
 
+  /**\brief Initialise new model; render depth not in build profile
+   *
+   * Doesn't create anything, so that the renderer for this render depth
+   * isn't instantiated.
+   *
+   * \param[out] out The state object in question.
+   *
+   * \returns 'true' if the state object has a valid model pointer at
+   *          the time the function returns.
+   */
+  static output create(argument out, const format &, std::false_type) {
+    return pass(out);
+  }
+
   /**\brief Return default exit status
    *
    * This is used instead of the apply method whenever
@@ -114,6 +174,205 @@ public:
   static output pass(argument out) { return out.model != 0; }
 };
 
+/**\brief Model factory
+ *
+ * Creates models for a topologic::state instance with the given functor, by
+ * way of efgy::geometry::with. All of the code that sets up a state's model
+ * goes through this class, so that builds with SPLIT_MODELS can take the
+ * models out of the translation unit that asks for them.
+ *
+ * \tparam Q    Base data type for calculations.
+ * \tparam d    Maximum number of dimensions supported by the state object.
+ * \tparam func State object update functor, e.g. topologic::updateModel
+ */
+template <typename Q, std::size_t d,
+          template <typename, template <class, std::size_t> class,
+                    std::size_t, std::size_t, typename> class func>
+class factory {
+public:
+  /**\brief Create model
+   *
+   * \param[out] s      The state object to update.
+   * \param[in]  format Vector coordinate format of the model.
+   * \param[in]  type   Model type, e.g. "cube".
+   * \param[in]  depth  Model depth.
+   * \param[in]  rdepth Render depth.
+   *
+   * \returns Whatever the functor returns; for topologic::updateModel, that
+   *          is whether the state object has a model afterwards.
+   */
+  static bool create(state<Q, d> &s, const std::string &format,
+                     const std::string &type, std::size_t depth,
+                     std::size_t rdepth) {
+    return efgy::geometry::with<Q, func, d>(s, format, type, depth, rdepth);
+  }
+};
+
+#if defined(SPLIT_MODELS)
+/**\brief Model registry
+ *
+ * With SPLIT_MODELS, the model renderers for each render depth are
+ * instantiated in a translation unit of their own, which registers a
+ * topologic::instance with this table. That way the translation units can
+ * be compiled in parallel, and changing MAXDEPTH only adds translation units
+ * instead of making a single one ever larger.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum number of dimensions supported by the state object.
+ */
+template <typename Q, std::size_t d> class registry {
+public:
+  /**\brief Model constructor
+   *
+   * Has the same signature as factory::create().
+   */
+  typedef bool (*constructor)(state<Q, d> &, const std::string &,
+                              const std::string &, std::size_t, std::size_t);
+
+  /**\brief Constructor for render depth
+   *
+   * \param[in] rdepth The render depth to look up; at most d.
+   *
+   * \returns A reference to the table entry for the render depth, which is
+   *          0 unless a constructor has been registered.
+   */
+  static constructor &at(std::size_t rdepth) {
+    static std::array<constructor, d + 1> table = {{}};
+    return table[rdepth];
+  }
+};
+
+/**\brief Filtered model update functor
+ *
+ * Used in place of topologic::updateModel when the models for a single
+ * render depth are instantiated. The 'type' alias resolves to
+ * topologic::updateModel for render depth r and to a functor that doesn't
+ * create anything for all other render depths, so those don't get
+ * instantiated.
+ *
+ * \tparam r Render depth to create models for.
+ */
+template <std::size_t r> class atRenderDepth {
+public:
+  /**\brief Model update functor for other render depths
+   *
+   * Leaves the state object alone, as topologic::updateModel::pass() does.
+   *
+   * \tparam Q      Base type for calculations.
+   * \tparam T      Model template class.
+   * \tparam d      Number of model dimensions.
+   * \tparam e      Number of render dimensions.
+   * \tparam format The vector format to use.
+   */
+  template <typename Q, template <class, std::size_t> class T, std::size_t d,
+            std::size_t e, typename format>
+  class skip {
+  public:
+    /**\brief Argument type; same as topologic::updateModel's */
+    typedef state<Q, e> &argument;
+
+    /**\brief Output type; same as topologic::updateModel's */
+    typedef bool output;
+
+    /**\brief Don't create model
+     *
+     * \returns 'true' if the state object already has a model.
+     */
+    static output apply(argument out, const format &) {
+      return out.model != 0;
+    }
+
+    /**\brief Return default exit status
+     *
+     * \returns 'true' if the state object already has a model.
+     */
+    static output pass(argument out) { return out.model != 0; }
+  };
+
+  /**\brief Model update functor
+   *
+   * \tparam Q      Base type for calculations.
+   * \tparam T      Model template class.
+   * \tparam d      Number of model dimensions.
+   * \tparam e      Number of render dimensions.
+   * \tparam format The vector format to use.
+   */
+  template <typename Q, template <class, std::size_t> class T, std::size_t d,
+            std::size_t e, typename format>
+  using type = typename std::conditional<e == r, updateModel<Q, T, d, e, format>,
+                                         skip<Q, T, d, e, format>>::type;
+};
+
+/**\brief Models for a render depth
+ *
+ * Instantiates the model renderers for render depth r, and registers them
+ * with topologic::registry when constructed. Each of the translation units
+ * that SPLIT_MODELS builds consist of an explicit instantiation of this
+ * class and a static instance of it.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum number of dimensions supported by the state object.
+ * \tparam r Render depth to instantiate models for.
+ */
+template <typename Q, std::size_t d, std::size_t r> class instance {
+public:
+  /**\brief Default constructor
+   *
+   * Registers create() as the constructor for render depth r.
+   */
+  instance(void) { registry<Q, d>::at(r) = create; }
+
+  /**\brief Create model
+   *
+   * Same as factory::create(), but only creates models with a render depth
+   * of r.
+   */
+  static bool create(state<Q, d> &s, const std::string &format,
+                     const std::string &type, std::size_t depth,
+                     std::size_t rdepth) {
+    return efgy::geometry::with<Q, atRenderDepth<r>::template type, d>(
+        s, format, type, depth, rdepth);
+  }
+};
+
+#endif
+
+/**\brief Model factory; topologic::updateModel
+ *
+ * Render depths greater than that of the state object are handed to
+ * topologic::dynamic, which doesn't need a template instance per dimension.
+ * With SPLIT_MODELS, topologic::updateModel is not instantiated by the code
+ * that wants a model, but looked up in topologic::registry instead. Render
+ * depths that no translation unit registered for behave like combinations
+ * that efgy::geometry::with can't find.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum number of dimensions supported by the state object.
+ */
+template <typename Q, std::size_t d> class factory<Q, d, updateModel> {
+public:
+  /**\brief Create model
+   *
+   * Same as the generic factory::create(), using topologic::dynamic for
+   * render depths greater than d, and the constructor that was registered
+   * for the render depth with SPLIT_MODELS.
+   */
+  static bool create(state<Q, d> &s, const std::string &format,
+                     const std::string &type, std::size_t depth,
+                     std::size_t rdepth) {
+    if (rdepth > d) {
+      return dynamic::create<Q, d>(s, format, type, depth, rdepth);
+    }
+#if defined(SPLIT_MODELS)
+    typename registry<Q, d>::constructor c = registry<Q, d>::at(rdepth);
+    return c ? c(s, format, type, depth, rdepth) : (s.model != 0);
+#else
+    return efgy::geometry::with<Q, updateModel, d>(s, format, type, depth,
+                                                   rdepth);
+#endif
+  }
+};
+
 /**\brief Update transformation matrix of state object instance
  *
  * This is a helper template to update a specific affine transformation
@@ -413,6 +672,213 @@ public:
       return xpathObject;
     }
   };
+
+  /**\brief Streaming metadata reader
+   *
+   * Reads the elements in topologic's namespace from an XML document in a
+   * single pass, using libxml2's xmlTextReader instead of building a DOM.
+   * Reading stops at the end of the first element named "metadata" that
+   * contained any of topologic's elements, so the cost of reading an SVG
+   * doesn't depend on how much geometry follows its metadata.
+   */
+  class reader {
+  public:
+    /**\brief Topologic element
+     *
+     * The local name and attributes of an element in topologic's
+     * namespace.
+     */
+    class element {
+    public:
+      /**\brief Get attribute
+       *
+       * \param[in] attribute Name of the attribute to look up.
+       *
+       * \returns A pointer to the attribute's value, or 0 if the element
+       *          doesn't have that attribute.
+       */
+      const std::string *get(const std::string &attribute) const {
+        for (const auto &a : attributes) {
+          if (a.first == attribute) {
+            return &a.second;
+          }
+        }
+        return 0;
+      }
+
+      /**\brief Local name of the element */
+      std::string name;
+
+      /**\brief Attributes, in document order
+       *
+       * Namespace declarations are not included.
+       */
+      std::vector<std::pair<std::string, std::string>> attributes;
+    };
+
+    /**\brief Construct with XML data and file name
+     *
+     * Reads the metadata from the XML document passed in as the first
+     * argument, using the given file name as a basis for relative
+     * references.
+     *
+     * \param[in] data     A proper, well-formed XML document
+     * \param[in] filename The source location of the document
+     */
+    reader(const std::string &data, const std::string &filename)
+        : valid(false) {
+      read(xmlReaderForMemory(data.data(), int(data.size()), filename.c_str(),
+                              0, XML_PARSE_NOERROR | XML_PARSE_NOWARNING));
+    }
+
+    /**\brief Construct with file name
+     *
+     * Reads the metadata from the given XML file. The file is read
+     * incrementally, so only the part up to the end of the metadata is
+     * actually read.
+     *
+     * \param[in] filename The file to read.
+     */
+    reader(const std::string &filename) : valid(false) {
+      read(xmlReaderForFile(filename.c_str(), 0,
+                            XML_PARSE_NOERROR | XML_PARSE_NOWARNING));
+    }
+
+    /**\brief Copy constructor
+     *
+     * Deleted, for consistency with the DOM parser.
+     */
+    reader(const reader &) = delete;
+
+    /**\brief Find first attribute value
+     *
+     * Looks up an attribute of the first element with the given name that
+     * has that attribute, like the XPath expression
+     * "//topologic:element/@attribute" does.
+     *
+     * \param[in] name      Local name of the element.
+     * \param[in] attribute Name of the attribute.
+     *
+     * \returns A pointer to the attribute's value, or 0 if there is no such
+     *          element.
+     */
+    const std::string *first(const std::string &name,
+                             const std::string &attribute) const {
+      for (const auto &e : elements) {
+        const std::string *v;
+        if ((e.name == name) && (v = e.get(attribute))) {
+          return v;
+        }
+      }
+      return 0;
+    }
+
+    /**\brief Has a valid XML file been read?
+     *
+     * Set to 'true' if the document could be read up to the end of its
+     * metadata, or to its end if there was no metadata, without errors.
+     */
+    bool valid;
+
+    /**\brief Elements in topologic's namespace, in document order */
+    std::vector<element> elements;
+
+  protected:
+    /**\brief Read metadata
+     *
+     * Collects the elements in topologic's namespace from the given text
+     * reader, then frees it.
+     *
+     * \param[in] r The text reader to read from; may be 0.
+     */
+    void read(xmlTextReaderPtr r) {
+      if (r == 0) {
+        return;
+      }
+
+      static const std::string ns = "http://ef.gy/2012/topologic";
+      int status;
+
+      while ((status = xmlTextReaderRead(r)) == 1) {
+        const int type = xmlTextReaderNodeType(r);
+        const char *uri = (const char *)xmlTextReaderConstNamespaceUri(r);
+        const char *name = (const char *)xmlTextReaderConstLocalName(r);
+
+        if ((type == XML_READER_TYPE_ELEMENT) && uri && (ns == uri)) {
+          element e;
+          e.name = name;
+          while (xmlTextReaderMoveToNextAttribute(r) == 1) {
+            if (xmlTextReaderIsNamespaceDecl(r) != 1) {
+              e.attributes.push_back(
+                  {(const char *)xmlTextReaderConstLocalName(r),
+                   (const char *)xmlTextReaderConstValue(r)});
+            }
+          }
+          elements.push_back(e);
+        } else if ((type == XML_READER_TYPE_END_ELEMENT) && name &&
+                   (std::strcmp(name, "metadata") == 0) && !elements.empty()) {
+          break;
+        }
+      }
+
+      valid = (status >= 0);
+      xmlFreeTextReader(r);
+    }
+  };
+
+  /**\brief Parse number
+   *
+   * Converts a decimal number in an attribute value. Numbers with at most
+   * 19 significant digits and small exponents - which covers everything
+   * topologic writes - are converted directly, with a single correctly
+   * rounded multiplication or division; anything else is passed on to
+   * std::strtod().
+   *
+   * \param[in] value The text to convert.
+   *
+   * \returns The value of the number; 0 if there is no number.
+   */
+  static double number(const std::string &value) {
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                    1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *p = value.c_str();
+    bool negative = false;
+    std::uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+
+    while ((*p == ' ') || (*p == '\t') || (*p == '\n')) {
+      p++;
+    }
+    if ((*p == '-') || (*p == '+')) {
+      negative = (*p == '-');
+      p++;
+    }
+    for (; (*p >= '0') && (*p <= '9'); p++) {
+      if (mantissa > 0 || *p != '0') {
+        digits++;
+      }
+      mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+    }
+    if (*p == '.') {
+      for (p++; (*p >= '0') && (*p <= '9'); p++) {
+        if (mantissa > 0 || *p != '0') {
+          digits++;
+        }
+        mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+        exponent--;
+      }
+    }
+    if ((*p == 'e') || (*p == 'E') || (digits > 19) ||
+        (mantissa >= (std::uint64_t(1) << 53)) || (exponent < -22)) {
+      return std::strtod(value.c_str(), 0);
+    }
+
+    double v = double(mantissa);
+    v = exponent < 0 ? v / powers[-exponent] : v;
+    return negative ? -v : v;
+  }
 };
 
 /**\brief Parse XML file contents and update global state object
@@ -453,6 +919,7 @@ static bool parse(state<Q, d> &s, xml::parser &parser) {
 
   if (parser.updateContext("//topologic:camera[count(@*) = " + dims + "][1]")) {
     do {
+      s.dirty = true;
       for (std::size_t i = 0; i < d; i++) {
         if ((i == 0) && ((value = parser.evaluate("@radius")) != "")) {
           s.fromp[0] = Q(std::stold(value));
@@ -511,6 +978,11 @@ static bool parse(state<Q, d> &s, xml::parser &parser) {
         "][1]"));
   }
 
+  if ((value = parser.evaluate("//topologic:projection[@depth = " + dims +
+                               "]/@mode")) != "") {
+    s.setOrthographic(value == "orthographic", d);
+  }
+
   return parse<Q, d - 1>(s, parser);
 }
 
@@ -609,6 +1081,21 @@ static bool parse(state<Q, 1> &s, xml::parser &parser) {
   if ((value = parser.evaluate("//topologic:flame/@coefficients")) != "") {
     s.parameter.flameCoefficients = Q(std::stold(value));
   }
+  if ((value = parser.evaluate("//topologic:raster/@width")) != "") {
+    s.rasterWidth = std::max(std::stoul(value), 1ul);
+  }
+  if ((value = parser.evaluate("//topologic:raster/@height")) != "") {
+    s.rasterHeight = std::max(std::stoul(value), 1ul);
+  }
+  if ((value = parser.evaluate("//topologic:lod/@tolerance")) != "") {
+    s.lodTolerance = Q(std::stold(value));
+  }
+  if ((value = parser.evaluate("//topologic:chaos/@samples")) != "") {
+    s.samples = std::stoull(value);
+  }
+  if ((value = parser.evaluate("//topologic:dedup/@tolerance")) != "") {
+    s.duplicateTolerance = Q(std::stold(value));
+  }
   return true;
 }
 
@@ -664,7 +1151,251 @@ static bool parseModel(state<Q, d> &s, xml::parser &parser) {
         rdepth++;
     }
 
-    return efgy::geometry::with<Q, func, d>(s, format, type, depth, rdepth);
+    return factory<Q, d, func>::create(s, format, type, depth, rdepth);
+  }
+
+  return false;
+}
+
+/**\brief Parse streamed XML metadata and update global state object
+ *
+ * Same as the xml::parser variant of this function, but using the elements
+ * collected by an xml::reader, which only needs to read a document up to the
+ * end of its metadata. The XPath queries of the xml::parser variant are
+ * emulated: all matching camera and transformation elements are applied in
+ * document order.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum number of dimensions supported by the given state
+ *           instance
+ *
+ * \param[out] s      The global state object to update.
+ * \param[in]  reader An XML reader instance, hopefully containing
+ *                    Topologic metadata.
+ *
+ * \returns 'true' if the reader could read the document, 'false'
+ *          otherwise.
+ */
+template <typename Q, std::size_t d>
+static bool parse(state<Q, d> &s, const xml::reader &reader) {
+  if (!reader.valid) {
+    return false;
+  }
+
+  std::ostringstream st;
+  const std::string *value;
+
+  for (const auto &e : reader.elements) {
+    if ((e.name == "camera") && (e.attributes.size() == d)) {
+      s.dirty = true;
+      for (std::size_t i = 0; i < d; i++) {
+        if ((i == 0) && (value = e.get("radius"))) {
+          s.fromp[0] = Q(xml::number(*value));
+          continue;
+        } else {
+          st.str("");
+          st << "theta-" << i;
+          if ((value = e.get(st.str()))) {
+            s.fromp[i] = Q(xml::number(*value));
+            continue;
+          }
+        }
+
+        if (i < sizeof(cartesianDimensions)) {
+          value = e.get(std::string(1, cartesianDimensions[i]));
+        } else {
+          st.str("");
+          st << "d-" << i;
+          value = e.get(st.str());
+        }
+        if (value) {
+          s.from[i] = Q(xml::number(*value));
+        }
+      }
+    } else if (e.name == "transformation") {
+      if ((value = e.get("depth")) && (xml::number(*value) == double(d)) &&
+          (value = e.get("matrix")) && (*value == "identity")) {
+        s.transformation = efgy::geometry::transformation::affine<Q, d>();
+      }
+
+      if (e.attributes.size() == (d + 1) * (d + 1)) {
+        for (std::size_t i = 0; i <= d; i++) {
+          for (std::size_t j = 0; j <= d; j++) {
+            st.str("");
+            st << "e" << i << "-" << j;
+            if ((value = e.get(st.str()))) {
+              s.transformation.matrix[i][j] = Q(xml::number(*value));
+            }
+          }
+        }
+      }
+    } else if ((e.name == "projection") && (value = e.get("depth")) &&
+               (xml::number(*value) == double(d)) && (value = e.get("mode"))) {
+      s.setOrthographic(*value == "orthographic", d);
+    }
+  }
+
+  return parse<Q, d - 1>(s, reader);
+}
+
+/**\brief Parse streamed XML metadata and update global state object; 1D
+ *        fix point.
+ *
+ * Same as the xml::parser variant of this function, but using the elements
+ * collected by an xml::reader. Where the metadata contains more than one
+ * matching attribute, the first one is used, as with the XPath queries of
+ * the xml::parser variant.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Maximum number of dimensions supported by the given state
+ *           instance
+ *
+ * \param[out] s      The global state object to update.
+ * \param[in]  reader An XML reader instance, hopefully containing
+ *                    Topologic metadata.
+ *
+ * \returns 'true' if the reader could read the document, 'false'
+ *          otherwise.
+ */
+template <typename Q, std::size_t d>
+static bool parse(state<Q, 1> &s, const xml::reader &reader) {
+  if (!reader.valid) {
+    return false;
+  }
+
+  const std::string *value;
+  if ((value = reader.first("precision", "polar"))) {
+    s.parameter.precision = Q(xml::number(*value));
+  }
+  if ((value = reader.first("options", "radius"))) {
+    s.parameter.radius = Q(xml::number(*value));
+  }
+  if ((value = reader.first("camera", "mode"))) {
+    s.polarCoordinates = (*value == "polar");
+  }
+  if ((value = reader.first("colour-background", "red"))) {
+    s.background.red = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-background", "green"))) {
+    s.background.green = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-background", "blue"))) {
+    s.background.blue = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-background", "alpha"))) {
+    s.background.alpha = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-wireframe", "red"))) {
+    s.wireframe.red = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-wireframe", "green"))) {
+    s.wireframe.green = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-wireframe", "blue"))) {
+    s.wireframe.blue = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-wireframe", "alpha"))) {
+    s.wireframe.alpha = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-surface", "red"))) {
+    s.surface.red = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-surface", "green"))) {
+    s.surface.green = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-surface", "blue"))) {
+    s.surface.blue = Q(xml::number(*value));
+  }
+  if ((value = reader.first("colour-surface", "alpha"))) {
+    s.surface.alpha = Q(xml::number(*value));
+  }
+  if ((value = reader.first("ifs", "iterations"))) {
+    s.parameter.iterations = Q(xml::number(*value));
+  }
+  if ((value = reader.first("ifs", "seed"))) {
+    s.parameter.seed = Q(xml::number(*value));
+  }
+  if ((value = reader.first("ifs", "functions"))) {
+    s.parameter.functions = Q(xml::number(*value));
+  }
+  if ((value = reader.first("ifs", "pre-rotate"))) {
+    s.parameter.preRotate = (*value == "yes");
+  }
+  if ((value = reader.first("ifs", "post-rotate"))) {
+    s.parameter.postRotate = (*value == "yes");
+  }
+  if ((value = reader.first("flame", "coefficients"))) {
+    s.parameter.flameCoefficients = Q(xml::number(*value));
+  }
+  if ((value = reader.first("raster", "width"))) {
+    s.rasterWidth = std::max(std::size_t(xml::number(*value)), std::size_t(1));
+  }
+  if ((value = reader.first("raster", "height"))) {
+    s.rasterHeight = std::max(std::size_t(xml::number(*value)), std::size_t(1));
+  }
+  if ((value = reader.first("lod", "tolerance"))) {
+    s.lodTolerance = Q(xml::number(*value));
+  }
+  if ((value = reader.first("chaos", "samples"))) {
+    s.samples = std::strtoull(value->c_str(), 0, 10);
+  }
+  if ((value = reader.first("dedup", "tolerance"))) {
+    s.duplicateTolerance = Q(xml::number(*value));
+  }
+  return true;
+}
+
+/**\brief Parse and update model data from streamed XML metadata
+ *
+ * Same as the xml::parser variant of this function, but using the elements
+ * collected by an xml::reader.
+ *
+ * \tparam Q    Base data type for calculations.
+ * \tparam d    Maximum number of dimensions supported by the given state
+ *              instance
+ * \tparam func State object update functor, e.g.
+ *              topologic::updateModel
+ *
+ * \param[out] s      The global state object to update.
+ * \param[in]  reader An XML reader instance, hopefully containing
+ *                    Topologic metadata.
+ *
+ * \returns 'true' if things worked out, 'false' otherwise.
+ */
+template <typename Q, std::size_t d,
+          template <typename, template <class, std::size_t> class,
+                    std::size_t, std::size_t, typename> class func>
+static bool parseModel(state<Q, d> &s, const xml::reader &reader) {
+  if (!reader.valid) {
+    return false;
+  }
+
+  std::string format = "cartesian";
+  const std::string *value;
+  if ((value = reader.first("coordinates", "format"))) {
+    format = *value;
+  }
+
+  for (const auto &e : reader.elements) {
+    const std::string *depthValue = e.get("depth"), *type = e.get("type");
+    if ((e.name != "model") || !depthValue || !type) {
+      continue;
+    }
+
+    int depth = int(std::strtol(depthValue->c_str(), 0, 10));
+    int rdepth = depth;
+    if ((value = e.get("render-depth"))) {
+      rdepth = int(std::strtol(value->c_str(), 0, 10));
+    }
+
+    if (rdepth == 0) {
+      rdepth = depth;
+      if ((*type == "sphere") || (*type == "moebius-strip") ||
+          (*type == "klein-bagle"))
+        rdepth++;
+    }
+
+    return factory<Q, d, func>::create(s, format, *type, depth, rdepth);
   }
 
   return false;
@@ -698,6 +1429,7 @@ static bool parse(state<Q, d> &s, efgy::json::value<> &value) {
     efgy::json::value<> &cameras = value("camera");
     for (efgy::json::value<> &c : cameras.toArray()) {
       if (c.isArray() && c.size() == d) {
+        s.dirty = true;
         for (std::size_t i = 0; i < d; i++) {
           if (c[i].type == efgy::json::value<>::number) {
             if (polar) {
@@ -727,6 +1459,17 @@ static bool parse(state<Q, d> &s, efgy::json::value<> &value) {
     }
   }
 
+  if (value("orthographic").isArray()) {
+    bool orthographic = false;
+    for (efgy::json::value<> &o : value("orthographic").toArray()) {
+      if (o.type == efgy::json::value<>::number) {
+        const Q dimension = o;
+        orthographic = orthographic || (dimension == Q(d));
+      }
+    }
+    s.setOrthographic(orthographic, d);
+  }
+
   return parse<Q, d - 1>(s, value);
 }
 
@@ -776,6 +1519,23 @@ static bool parse(state<Q, 1> &s, efgy::json::value<> &value) {
   if (value("flameCoefficients").isNumber()) {
     s.parameter.flameCoefficients = (int)value("flameCoefficients");
   }
+  if (value("rasterWidth").isNumber() &&
+      (value("rasterWidth").asNumber() >= 1)) {
+    s.rasterWidth = std::size_t(value("rasterWidth").asNumber());
+  }
+  if (value("rasterHeight").isNumber() &&
+      (value("rasterHeight").asNumber() >= 1)) {
+    s.rasterHeight = std::size_t(value("rasterHeight").asNumber());
+  }
+  if (value("lodTolerance").isNumber()) {
+    s.lodTolerance = value("lodTolerance");
+  }
+  if (value("samples").isNumber()) {
+    s.samples = std::uint64_t(value("samples").asNumber());
+  }
+  if (value("duplicateTolerance").isNumber()) {
+    s.duplicateTolerance = value("duplicateTolerance");
+  }
 
   if (value("preRotate").type != efgy::json::value<>::null) {
     s.parameter.preRotate = (bool)value("preRotate");
@@ -861,7 +1621,7 @@ static bool parseModel(state<Q, d> &s, efgy::json::value<> &value) {
     rdepth = crdepth.asNumber();
   }
 
-  return efgy::geometry::with<Q, func, d>(s, format, type, depth, rdepth);
+  return factory<Q, d, func>::create(s, format, type, depth, rdepth);
 }
 }
 
@@ -0,0 +1,139 @@
+/**\file
+ * \brief Build profiles
+ *
+ * A binary that only ever renders a handful of models in a few dimensions
+ * doesn't need to carry the code for all of the others. The macros in this
+ * file select which models, vector formats and render depths are built into
+ * a binary; they're usually set through the makefile variables of the same
+ * name.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_PROFILE_H)
+#define TOPOLOGIC_PROFILE_H
+
+#include <cstddef>
+
+#if !defined(MODELS)
+/**\brief Models to build
+ *
+ * A string with a comma-separated list of the IDs of the models to build,
+ * e.g. "cube,simplex"; the default of "*" builds all of the models that
+ * libefgy provides.
+ */
+#define MODELS "*"
+#endif
+
+#if !defined(FORMATS)
+/**\brief Vector formats to build
+ *
+ * A string with a comma-separated list of the IDs of the vector coordinate
+ * formats to build, e.g. "cartesian"; the default of "*" builds all of them.
+ */
+#define FORMATS "*"
+#endif
+
+#if !defined(FLOATS)
+/**\brief Build single precision frontend?
+ *
+ * Set to 1 to also build the frontend, and with it all of the models, with
+ * floats, so that the "numbers:float" option can be used. Off by default, as
+ * it compiles every model twice.
+ */
+#define FLOATS 0
+#endif
+
+#if !defined(MINDEPTH)
+/**\brief Minimum render depth
+ *
+ * Models are only built for render depths between this and the maximum
+ * render depth of a frontend, which is usually MAXDEPTH.
+ */
+#define MINDEPTH 0
+#endif
+
+namespace topologic {
+/**\brief Build profile
+ *
+ * Functions to query the settings of the build profile that a binary was
+ * compiled with.
+ */
+namespace profile {
+/**\brief Match list item
+ *
+ * \param[in] list Remainder of a comma-separated list.
+ * \param[in] name The name to match.
+ *
+ * \returns 'true' if the list starts with an item that is equal to name.
+ */
+constexpr bool prefix(const char *list, const char *name) {
+  return *name == 0 ? ((*list == 0) || (*list == ','))
+                    : ((*list == *name) && prefix(list + 1, name + 1));
+}
+
+/**\brief Next list item
+ *
+ * \param[in] list Remainder of a comma-separated list.
+ *
+ * \returns The list after its first comma, or 0 if there are no more items.
+ */
+constexpr const char *next(const char *list) {
+  return *list == 0 ? 0 : (*list == ',' ? list + 1 : next(list + 1));
+}
+
+/**\brief Is name in list?
+ *
+ * \param[in] list A comma-separated list, or "*".
+ * \param[in] name The name to look for.
+ *
+ * \returns 'true' if the list is "*" or contains the given name.
+ */
+constexpr bool listed(const char *list, const char *name) {
+  return (list != 0) &&
+         ((*list == '*') || prefix(list, name) || listed(next(list), name));
+}
+
+/**\brief Is model built?
+ *
+ * \param[in] id The ID of a model, e.g. "cube".
+ *
+ * \returns 'true' if the build profile includes the model.
+ */
+constexpr bool model(const char *id) { return listed(MODELS, id); }
+
+/**\brief Is vector format built?
+ *
+ * \param[in] id The ID of a vector format, e.g. "cartesian".
+ *
+ * \returns 'true' if the build profile includes the vector format.
+ */
+constexpr bool format(const char *id) { return listed(FORMATS, id); }
+
+/**\brief Are floats built?
+ *
+ * \returns 'true' if the build profile includes the single precision
+ *          frontend.
+ */
+constexpr bool floats(void) { return FLOATS != 0; }
+
+/**\brief Is render depth built?
+ *
+ * Usable in constant expressions, so that models for render depths outside
+ * of the build profile aren't instantiated at all.
+ *
+ * \param[in] e A render depth.
+ *
+ * \returns 'true' if the build profile includes the render depth.
+ */
+constexpr bool renderDepth(std::size_t e) { return e >= MINDEPTH; }
+}
+}
+
+#endif
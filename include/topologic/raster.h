@@ -0,0 +1,553 @@
+/**\file
+ * \brief CPU rasteriser
+ *
+ * Contains a small software rasteriser that draws projected faces into a
+ * framebuffer, so that topologic can produce bitmaps without an OpenGL
+ * context - e.g. for thumbnails on headless servers. The image is split into
+ * tiles that are shaded in parallel; coverage is determined with edge
+ * functions, four pixels at a time if SSE is available.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_RASTER_H)
+#define TOPOLOGIC_RASTER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace topologic {
+/**\brief Software framebuffer
+ *
+ * Collects triangles and lines in screen coordinates, then rasterises them
+ * into an RGBA image. Primitives are drawn in the order they were added,
+ * with alpha blending, so the result matches what an SVG viewer would show
+ * for the same paths. Pixel centres are sampled once, with a top-left fill
+ * rule, so that pixels on edges shared by adjacent triangles are only
+ * blended once.
+ */
+class framebuffer {
+public:
+  /**\brief Colour type
+   *
+   * Straight, i.e. not premultiplied, RGBA colour with components in the
+   * range [0,1].
+   */
+  using colour = std::array<float, 4>;
+
+  /**\brief Tile size, in pixels
+   *
+   * Tiles are square; each tile is shaded by a single thread.
+   */
+  static const std::size_t tile = 64;
+
+  /**\brief Construct with size and background
+   *
+   * \param[in] pWidth      Width of the image, in pixels.
+   * \param[in] pHeight     Height of the image, in pixels.
+   * \param[in] pBackground Colour to fill the image with.
+   */
+  framebuffer(std::size_t pWidth, std::size_t pHeight,
+              const colour &pBackground)
+      : width(pWidth), height(pHeight),
+        tilesX((pWidth + tile - 1) / tile), tilesY((pHeight + tile - 1) / tile),
+        pixels(pWidth * pHeight * 4), bins(tilesX * tilesY) {
+    const colour c = premultiply(pBackground);
+    for (std::size_t i = 0; i < pixels.size(); i += 4) {
+      std::copy(c.begin(), c.end(), pixels.begin() + i);
+    }
+  }
+
+  /**\brief Add triangle
+   *
+   * Queues a triangle for rasterisation. Degenerate triangles and triangles
+   * that are entirely outside of the image are dropped.
+   *
+   * \param[in] x The X coordinates of the vertices, in pixels.
+   * \param[in] y The Y coordinates of the vertices, in pixels.
+   * \param[in] c The colour to fill the triangle with.
+   */
+  void triangle(std::array<double, 3> x, std::array<double, 3> y,
+                const colour &c) {
+    const double area = (x[2] - x[0]) * (y[1] - y[0]) -
+                        (y[2] - y[0]) * (x[1] - x[0]);
+    if (!(area != 0.) || !std::isfinite(area)) {
+      return;
+    }
+    if (area < 0.) {
+      std::swap(x[1], x[2]);
+      std::swap(y[1], y[2]);
+    }
+
+    primitive p;
+    for (std::size_t e = 0; e < 3; e++) {
+      const std::size_t n = (e + 1) % 3;
+      const double dx = x[n] - x[e], dy = y[n] - y[e];
+      p.a[e] = float(dy);
+      p.b[e] = float(-dx);
+      p.x[e] = float(x[e]);
+      p.y[e] = float(y[e]);
+      p.inclusive[e] = (dy < 0.) || ((dy == 0.) && (dx > 0.));
+    }
+    p.fill = premultiply(c);
+
+    const double minX = std::min({x[0], x[1], x[2]});
+    const double maxX = std::max({x[0], x[1], x[2]});
+    const double minY = std::min({y[0], y[1], y[2]});
+    const double maxY = std::max({y[0], y[1], y[2]});
+    if ((maxX < 0.) || (maxY < 0.) || (minX > double(width)) ||
+        (minY > double(height))) {
+      return;
+    }
+
+    p.x0 = std::size_t(std::max(0., std::ceil(minX - 0.5)));
+    p.y0 = std::size_t(std::max(0., std::ceil(minY - 0.5)));
+    p.x1 = std::size_t(std::min(double(width), std::floor(maxX - 0.5) + 1.));
+    p.y1 = std::size_t(std::min(double(height), std::floor(maxY - 0.5) + 1.));
+    if ((p.x0 >= p.x1) || (p.y0 >= p.y1)) {
+      return;
+    }
+
+    const std::size_t id = primitives.size();
+    primitives.push_back(p);
+    for (std::size_t ty = p.y0 / tile; ty <= (p.y1 - 1) / tile; ty++) {
+      for (std::size_t tx = p.x0 / tile; tx <= (p.x1 - 1) / tile; tx++) {
+        bins[ty * tilesX + tx].push_back(id);
+      }
+    }
+  }
+
+  /**\brief Add line
+   *
+   * Queues a line segment for rasterisation, as a rectangle of the given
+   * width made up of two triangles.
+   *
+   * \param[in] x0 X coordinate of the start point, in pixels.
+   * \param[in] y0 Y coordinate of the start point, in pixels.
+   * \param[in] x1 X coordinate of the end point, in pixels.
+   * \param[in] y1 Y coordinate of the end point, in pixels.
+   * \param[in] w  Width of the line, in pixels.
+   * \param[in] c  The colour to draw the line with.
+   */
+  void line(double x0, double y0, double x1, double y1, double w,
+            const colour &c) {
+    const double dx = x1 - x0, dy = y1 - y0;
+    const double l = std::sqrt(dx * dx + dy * dy);
+    if (!(l > 0.)) {
+      return;
+    }
+    const double nx = -dy / l * w / 2., ny = dx / l * w / 2.;
+
+    triangle({{x0 + nx, x1 + nx, x1 - nx}}, {{y0 + ny, y1 + ny, y1 - ny}}, c);
+    triangle({{x0 + nx, x1 - nx, x0 - nx}}, {{y0 + ny, y1 - ny, y0 - ny}}, c);
+  }
+
+  /**\brief Blend single pixel
+   *
+   * Composites a colour over a single pixel, right away rather than when
+   * render() is called.
+   *
+   * \param[in] x Column of the pixel.
+   * \param[in] y Row of the pixel.
+   * \param[in] c The colour to blend.
+   */
+  void point(std::size_t x, std::size_t y, const colour &c) {
+    if ((x < width) && (y < height)) {
+      blend(&pixels[(y * width + x) * 4], premultiply(c));
+    }
+  }
+
+  /**\brief Rasterise queued primitives
+   *
+   * Shades all of the tiles with the primitives that have been queued so
+   * far, using the given number of threads.
+   *
+   * \param[in] threads Number of threads to use; 0 to use as many as there
+   *                    are hardware threads.
+   */
+  void render(std::size_t threads = 0) {
+    if (threads == 0) {
+      threads = std::thread::hardware_concurrency();
+    }
+    threads = std::max<std::size_t>(1, std::min(threads, bins.size()));
+
+    std::atomic<std::size_t> next(0);
+    auto work = [this, &next]() {
+      for (std::size_t t = next++; t < bins.size(); t = next++) {
+        shade(t);
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threads; i++) {
+      pool.emplace_back(work);
+    }
+    work();
+    for (auto &t : pool) {
+      t.join();
+    }
+
+    primitives.clear();
+    for (auto &b : bins) {
+      b.clear();
+    }
+  }
+
+  /**\brief Write PPM image
+   *
+   * Writes the image as a binary PPM. PPM has no alpha channel, so the
+   * alpha values are simply dropped.
+   *
+   * \param[out] output The stream to write to.
+   *
+   * \returns 'true' if the image was written successfully.
+   */
+  bool ppm(std::ostream &output) const {
+    output << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<char> row(width * 3);
+    for (std::size_t y = 0; y < height; y++) {
+      for (std::size_t x = 0; x < width; x++) {
+        const colour c = straight(y * width + x);
+        for (std::size_t k = 0; k < 3; k++) {
+          row[x * 3 + k] = char(quantise(c[k]));
+        }
+      }
+      output.write(row.data(), row.size());
+    }
+
+    return bool(output);
+  }
+
+  /**\brief Write PNG image
+   *
+   * Writes the image as an 8-bit RGBA PNG. The image data is stored in
+   * uncompressed deflate blocks, so this doesn't need a compression library;
+   * the result is about as large as the equivalent PPM.
+   *
+   * \param[out] output The stream to write to.
+   *
+   * \returns 'true' if the image was written successfully.
+   */
+  bool png(std::ostream &output) const {
+    std::vector<unsigned char> raw;
+    raw.reserve(height * (width * 4 + 1));
+    for (std::size_t y = 0; y < height; y++) {
+      raw.push_back(0);
+      for (std::size_t x = 0; x < width; x++) {
+        const colour c = straight(y * width + x);
+        for (std::size_t k = 0; k < 4; k++) {
+          raw.push_back(quantise(c[k]));
+        }
+      }
+    }
+
+    std::vector<unsigned char> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78);
+    z.push_back(0x01);
+    std::size_t i = 0;
+    do {
+      const std::size_t n = std::min<std::size_t>(65535, raw.size() - i);
+      z.push_back(i + n == raw.size() ? 1 : 0);
+      z.push_back(n & 0xff);
+      z.push_back(n >> 8);
+      z.push_back(~n & 0xff);
+      z.push_back((~n >> 8) & 0xff);
+      z.insert(z.end(), raw.begin() + i, raw.begin() + i + n);
+      i += n;
+    } while (i < raw.size());
+    bigEndian(z, adler32(raw));
+
+    std::vector<unsigned char> header;
+    bigEndian(header, width);
+    bigEndian(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+
+    output.write("\x89PNG\r\n\x1a\n", 8);
+    chunk(output, "IHDR", header);
+    chunk(output, "IDAT", z);
+    chunk(output, "IEND", std::vector<unsigned char>());
+
+    return bool(output);
+  }
+
+  /**\brief Width of the image, in pixels */
+  const std::size_t width;
+
+  /**\brief Height of the image, in pixels */
+  const std::size_t height;
+
+protected:
+  /**\brief Queued triangle
+   *
+   * A triangle in the form used by the shader: one edge function per edge,
+   * in the form a * (px - x) + b * (py - y), which is non-negative for
+   * points inside the triangle, and the pixel bounding box.
+   */
+  struct primitive {
+    /**\brief X coefficients of the edge functions */
+    float a[3];
+
+    /**\brief Y coefficients of the edge functions */
+    float b[3];
+
+    /**\brief X coordinates of the edges' start points */
+    float x[3];
+
+    /**\brief Y coordinates of the edges' start points */
+    float y[3];
+
+    /**\brief Whether pixels exactly on an edge are inside
+     *
+     * Set for top and left edges, according to the fill rule.
+     */
+    bool inclusive[3];
+
+    /**\brief Premultiplied fill colour */
+    colour fill;
+
+    /**\brief First column of the bounding box */
+    std::size_t x0;
+
+    /**\brief First row of the bounding box */
+    std::size_t y0;
+
+    /**\brief Column after the bounding box */
+    std::size_t x1;
+
+    /**\brief Row after the bounding box */
+    std::size_t y1;
+  };
+
+  /**\brief Shade tile
+   *
+   * Rasterises all of the primitives that overlap the given tile, in the
+   * order they were added.
+   *
+   * \param[in] t Index of the tile to shade.
+   */
+  void shade(std::size_t t) {
+    const std::size_t tx0 = (t % tilesX) * tile, ty0 = (t / tilesX) * tile;
+    const std::size_t tx1 = std::min(width, tx0 + tile);
+    const std::size_t ty1 = std::min(height, ty0 + tile);
+
+    for (const std::size_t &id : bins[t]) {
+      const primitive &p = primitives[id];
+      const std::size_t xs = std::max(p.x0, tx0), xe = std::min(p.x1, tx1);
+      const std::size_t ys = std::max(p.y0, ty0), ye = std::min(p.y1, ty1);
+
+      for (std::size_t y = ys; y < ye; y++) {
+        for (std::size_t x = xs; x < xe; x += 4) {
+          unsigned int mask = cover(p, x, y);
+          for (std::size_t k = 0; (k < 4) && (x + k < xe); k++) {
+            if (mask & (1 << k)) {
+              blend(&pixels[(y * width + x + k) * 4], p.fill);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**\brief Test pixel coverage
+   *
+   * Evaluates the edge functions of a triangle at the centres of four
+   * consecutive pixels in a row.
+   *
+   * \param[in] p The triangle to test against.
+   * \param[in] x Column of the first pixel.
+   * \param[in] y Row of the pixels.
+   *
+   * \returns A bit mask with bit k set if pixel x+k is inside the triangle.
+   */
+  static unsigned int cover(const primitive &p, std::size_t x, std::size_t y) {
+#if defined(__SSE__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)),
+                                 _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+    const float py = float(y) + 0.5f;
+    int mask = 0xf;
+    for (std::size_t e = 0; e < 3; e++) {
+      const __m128 v = _mm_add_ps(
+          _mm_mul_ps(_mm_set1_ps(p.a[e]), _mm_sub_ps(px, _mm_set1_ps(p.x[e]))),
+          _mm_set1_ps(p.b[e] * (py - p.y[e])));
+      mask &= _mm_movemask_ps(p.inclusive[e] ? _mm_cmpge_ps(v, zero)
+                                             : _mm_cmpgt_ps(v, zero));
+    }
+    return (unsigned int)mask;
+#else
+    const float py = float(y) + 0.5f;
+    unsigned int mask = 0;
+    for (std::size_t k = 0; k < 4; k++) {
+      const float px = float(x + k) + 0.5f;
+      bool inside = true;
+      for (std::size_t e = 0; inside && (e < 3); e++) {
+        const float v = p.a[e] * (px - p.x[e]) + p.b[e] * (py - p.y[e]);
+        inside = p.inclusive[e] ? (v >= 0.f) : (v > 0.f);
+      }
+      mask |= inside ? (1 << k) : 0;
+    }
+    return mask;
+#endif
+  }
+
+  /**\brief Blend pixel
+   *
+   * Composites a premultiplied colour over a pixel.
+   *
+   * \param[in,out] d The pixel to blend into.
+   * \param[in]     s The premultiplied colour to blend.
+   */
+  static void blend(float *d, const colour &s) {
+#if defined(__SSE__)
+    const __m128 inv = _mm_set1_ps(1.f - s[3]);
+    _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(s.data()),
+                                _mm_mul_ps(_mm_loadu_ps(d), inv)));
+#else
+    for (std::size_t k = 0; k < 4; k++) {
+      d[k] = s[k] + d[k] * (1.f - s[3]);
+    }
+#endif
+  }
+
+  /**\brief Premultiply colour
+   *
+   * \param[in] c A straight colour.
+   *
+   * \returns The colour with its RGB components multiplied by its alpha.
+   */
+  static colour premultiply(const colour &c) {
+    return {{c[0] * c[3], c[1] * c[3], c[2] * c[3], c[3]}};
+  }
+
+  /**\brief Get straight pixel colour
+   *
+   * \param[in] i Index of the pixel.
+   *
+   * \returns The colour of the pixel, with premultiplication undone.
+   */
+  colour straight(std::size_t i) const {
+    const float *p = &pixels[i * 4];
+    if (!(p[3] > 0.f)) {
+      return {{0.f, 0.f, 0.f, 0.f}};
+    }
+    return {{p[0] / p[3], p[1] / p[3], p[2] / p[3], p[3]}};
+  }
+
+  /**\brief Quantise colour component
+   *
+   * \param[in] v A colour component in the range [0,1].
+   *
+   * \returns The component as an 8-bit value.
+   */
+  static unsigned char quantise(float v) {
+    return (unsigned char)(std::min(1.f, std::max(0.f, v)) * 255.f + 0.5f);
+  }
+
+  /**\brief Append 32-bit big-endian integer
+   *
+   * \param[out] v     The buffer to append to.
+   * \param[in]  value The value to append.
+   */
+  static void bigEndian(std::vector<unsigned char> &v, std::uint32_t value) {
+    v.insert(v.end(), {(unsigned char)(value >> 24),
+                       (unsigned char)(value >> 16),
+                       (unsigned char)(value >> 8), (unsigned char)value});
+  }
+
+  /**\brief Calculate Adler-32 checksum
+   *
+   * \param[in] data The data to checksum.
+   *
+   * \returns The Adler-32 checksum of the data, as used by zlib.
+   */
+  static std::uint32_t adler32(const std::vector<unsigned char> &data) {
+    std::uint32_t a = 1, b = 0;
+    for (std::size_t i = 0; i < data.size();) {
+      for (std::size_t n = std::min<std::size_t>(5552, data.size() - i); n > 0;
+           n--, i++) {
+        a += data[i];
+        b += a;
+      }
+      a %= 65521;
+      b %= 65521;
+    }
+    return (b << 16) | a;
+  }
+
+  /**\brief Write PNG chunk
+   *
+   * Writes a PNG chunk with the given type and contents, along with its
+   * length and CRC-32.
+   *
+   * \param[out] output The stream to write to.
+   * \param[in]  type   The four-character chunk type.
+   * \param[in]  data   The chunk's contents.
+   */
+  static void chunk(std::ostream &output, const char *type,
+                    const std::vector<unsigned char> &data) {
+    static std::array<std::uint32_t, 256> table = []() {
+      std::array<std::uint32_t, 256> t;
+      for (std::uint32_t n = 0; n < 256; n++) {
+        std::uint32_t c = n;
+        for (std::size_t k = 0; k < 8; k++) {
+          c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+        }
+        t[n] = c;
+      }
+      return t;
+    }();
+
+    std::vector<unsigned char> head, tail;
+    bigEndian(head, data.size());
+    head.insert(head.end(), type, type + 4);
+
+    std::uint32_t crc = 0xffffffffu;
+    for (std::size_t i = 4; i < head.size(); i++) {
+      crc = table[(crc ^ head[i]) & 0xff] ^ (crc >> 8);
+    }
+    for (const unsigned char &c : data) {
+      crc = table[(crc ^ c) & 0xff] ^ (crc >> 8);
+    }
+    bigEndian(tail, crc ^ 0xffffffffu);
+
+    output.write((const char *)head.data(), head.size());
+    output.write((const char *)data.data(), data.size());
+    output.write((const char *)tail.data(), tail.size());
+  }
+
+  /**\brief Number of tile columns */
+  const std::size_t tilesX;
+
+  /**\brief Number of tile rows */
+  const std::size_t tilesY;
+
+  /**\brief Premultiplied RGBA pixels, row by row */
+  std::vector<float> pixels;
+
+  /**\brief Queued triangles */
+  std::vector<primitive> primitives;
+
+  /**\brief Indices of the queued triangles that overlap each tile */
+  std::vector<std::vector<std::size_t>> bins;
+};
+}
+
+#endif
@@ -22,6 +22,25 @@
 #if !defined(NO_OPENGL)
 #include <ef.gy/render-opengl.h>
 #endif
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include <topologic/cache.h>
+#include <topologic/dedup.h>
+#include <topologic/flame.h>
+#include <topologic/ifs.h>
+#include <topologic/raster.h>
+#include <topologic/stats.h>
+#include <topologic/stream.h>
+#include <topologic/version.h>
 
 namespace topologic {
 /**\brief Cartesian dimension shorthands
@@ -40,12 +59,364 @@ static const char cartesianDimensions[] =
 
 template <typename Q, std::size_t d> class state;
 
+/**\brief Little-endian binary writer
+ *
+ * Collects fixed-width integers and floating point values in little-endian
+ * byte order, regardless of the host's byte order, and writes them to an
+ * output stream in large blocks. Used for binary output formats.
+ */
+class binary {
+public:
+  /**\brief Construct with output stream
+   *
+   * \param[out] pOutput The stream to write to.
+   */
+  binary(std::ostream &pOutput) : output(pOutput), size(0) {}
+
+  /**\brief Destructor
+   *
+   * Writes out any data that is still in the buffer.
+   */
+  ~binary(void) { flush(); }
+
+  /**\brief Append integer
+   *
+   * Appends the given value as an unsigned, little-endian integer with the
+   * given number of bytes.
+   *
+   * \param[in] value The value to append.
+   * \param[in] bytes The width of the value, in bytes.
+   *
+   * \returns A reference to this object.
+   */
+  binary &integer(unsigned long long value, std::size_t bytes) {
+    if (size + bytes > sizeof(buffer)) {
+      flush();
+    }
+    for (std::size_t i = 0; i < bytes; i++) {
+      buffer[size++] = char((value >> (8 * i)) & 0xff);
+    }
+    return *this;
+  }
+
+  /**\brief Append floating point value
+   *
+   * Appends the given value as a little-endian IEEE 754 single or double
+   * precision value.
+   *
+   * \param[in] value The value to append.
+   * \param[in] bytes Either 4 for single or 8 for double precision.
+   *
+   * \returns A reference to this object.
+   */
+  binary &real(double value, std::size_t bytes) {
+    if (bytes == 4) {
+      float f = float(value);
+      std::uint32_t v;
+      std::memcpy(&v, &f, sizeof(v));
+      return integer(v, 4);
+    }
+    std::uint64_t v;
+    std::memcpy(&v, &value, sizeof(v));
+    return integer(v, 8);
+  }
+
+  /**\brief Write buffer
+   *
+   * Writes all the data in the buffer to the output stream.
+   *
+   * \returns 'true' if the output stream is still in a good state.
+   */
+  bool flush(void) {
+    output.write(buffer, size);
+    size = 0;
+    return bool(output);
+  }
+
+protected:
+  /**\brief Output stream */
+  std::ostream &output;
+
+  /**\brief Data that has not been written yet */
+  char buffer[65536];
+
+  /**\brief Number of bytes in the buffer */
+  std::size_t size;
+};
+
 /**\brief Templates related to Topologic's rendering process
  *
  * This namespace encompasses all of the templates related to topologic's
  * actual rendering process, as opposed to state management or setup tasks.
  */
 namespace render {
+/**\brief Project vector to 2D; 2D fix point
+ *
+ * Applies the 2D transformation matrix to the given vector, which is already
+ * in two dimensions so there's no projection left to apply.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Number of dimensions of the vector; ignored.
+ *
+ * \param[in] s The state object with the matrix to apply.
+ * \param[in] v The vector to transform.
+ *
+ * \returns The transformed vector.
+ */
+template <typename Q, std::size_t d>
+static inline efgy::math::vector<Q, 2> project(const state<Q, 2> &s,
+                                               const efgy::math::vector<Q, 2> &v) {
+  return s.transformation * v;
+}
+
+/**\brief Project vector to 2D
+ *
+ * Applies the transformation and projection matrices of each dimension of the
+ * given state object to a vector, recursively, until the vector has been
+ * projected all the way down to two dimensions. This mirrors what libefgy's
+ * renderers do, but without having to go through an actual renderer.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Number of dimensions of the vector.
+ *
+ * \param[in] s The state object with the matrices to apply.
+ * \param[in] v The vector to project.
+ *
+ * \returns The projected vector.
+ */
+template <typename Q, std::size_t d>
+static inline efgy::math::vector<Q, 2> project(const state<Q, d> &s,
+                                               const efgy::math::vector<Q, d> &v) {
+  return project<Q, d - 1>(s, s.projection * (s.transformation * v));
+}
+
+/**\brief Compose projection matrices; 2D fix point
+ *
+ * Multiplies the matrix composed so far with the 2D transformation matrix.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Number of dimensions; ignored.
+ *
+ * \param[in]     s The state object with the matrix to apply.
+ * \param[in,out] m The matrix composed so far, with r rows and 3 columns,
+ *                  in row-major order.
+ * \param[in]     r The number of rows of the matrix.
+ */
+template <typename Q, std::size_t d>
+static void compose(const state<Q, 2> &s, std::vector<Q> &m,
+                    const std::size_t r) {
+  std::vector<Q> o(r * 3, Q(0));
+  for (std::size_t i = 0; i < r; i++) {
+    for (std::size_t k = 0; k < 3; k++) {
+      for (std::size_t j = 0; j < 3; j++) {
+        o[i * 3 + j] += m[i * 3 + k] * s.transformation.matrix[k][j];
+      }
+    }
+  }
+  m.swap(o);
+}
+
+/**\brief Compose projection matrices
+ *
+ * Multiplies the matrix composed so far with this dimension's
+ * transformation and projection matrices, then recurses into the lower
+ * dimensions. Projecting from d to d-1 dimensions divides by the
+ * homogeneous coordinate and drops the depth, which is the same as dropping
+ * the depth column of the matrix and keeping the homogeneous coordinate
+ * around, so the whole chain composes into a single matrix that maps
+ * homogeneous coordinates in the model's render depth to homogeneous 2D
+ * coordinates. This works for perspective and orthographic projections
+ * alike.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Number of dimensions of this step.
+ *
+ * \param[in]     s The state object with the matrices to apply.
+ * \param[in,out] m The matrix composed so far, with r rows and d+1 columns,
+ *                  in row-major order.
+ * \param[in]     r The number of rows of the matrix.
+ */
+template <typename Q, std::size_t d>
+static void compose(const state<Q, d> &s, std::vector<Q> &m,
+                    const std::size_t r) {
+  Q c[d + 1][d];
+  for (std::size_t i = 0; i <= d; i++) {
+    for (std::size_t j = 0; j < d; j++) {
+      const std::size_t l = j < d - 1 ? j : d;
+      c[i][j] = Q(0);
+      for (std::size_t k = 0; k <= d; k++) {
+        c[i][j] += s.transformation.matrix[i][k] * s.projection.matrix[k][l];
+      }
+    }
+  }
+
+  std::vector<Q> o(r * d, Q(0));
+  for (std::size_t i = 0; i < r; i++) {
+    for (std::size_t k = 0; k <= d; k++) {
+      for (std::size_t j = 0; j < d; j++) {
+        o[i * d + j] += m[i * (d + 1) + k] * c[k][j];
+      }
+    }
+  }
+  m.swap(o);
+
+  compose<Q, d - 1>(s, m, r);
+}
+
+/**\brief Project batch of vectors to 2D
+ *
+ * Does the same as project(), but for a whole batch of vectors at once. The
+ * vectors are stored as a structure of arrays: the first coordinate of all of
+ * the vectors, then the second coordinate of all of them, and so on. The
+ * matrices of all the dimensions are composed into a single matrix with
+ * compose(), so each vector only needs one matrix-vector product and one
+ * homogeneous divide. All of the inner loops run over one coordinate of all
+ * the vectors, which is contiguous, so compilers can vectorise them.
+ *
+ * The vectors may use a different data type than the state object, e.g.
+ * float vectors with a double state object. The matrices are then still
+ * composed with the state's precision, and only rounded to the vectors'
+ * data type to apply them.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Number of dimensions of the vectors.
+ * \tparam V Data type of the vectors' coordinates.
+ *
+ * \param[in]     s The state object with the matrices to apply.
+ * \param[in,out] c The coordinates of the vectors, d * n values. Contains the
+ *                  projected X and Y coordinates afterwards, 2 * n values.
+ * \param[in]     n The number of vectors.
+ */
+template <typename Q, std::size_t d, typename V>
+static void project(const state<Q, d> &s, std::vector<V> &c,
+                    const std::size_t n) {
+  std::vector<Q> m((d + 1) * (d + 1), Q(0));
+  for (std::size_t i = 0; i <= d; i++) {
+    m[i * (d + 1) + i] = Q(1);
+  }
+  compose<Q, d>(s, m, d + 1);
+
+  std::vector<V> x(n, V(m[d * 3])), y(n, V(m[d * 3 + 1])),
+      w(n, V(m[d * 3 + 2]));
+  for (std::size_t i = 0; i < d; i++) {
+    const V *in = c.data() + i * n;
+    const V mx = V(m[i * 3]), my = V(m[i * 3 + 1]), mw = V(m[i * 3 + 2]);
+    for (std::size_t v = 0; v < n; v++) {
+      x[v] += in[v] * mx;
+      y[v] += in[v] * my;
+      w[v] += in[v] * mw;
+    }
+  }
+
+  c.resize(2 * n);
+  for (std::size_t v = 0; v < n; v++) {
+    c[v] = x[v] / w[v];
+    c[n + v] = y[v] / w[v];
+  }
+}
+
+/**\brief Write SVG path
+ *
+ * Writes a closed SVG path element for the given, already projected face.
+ * Each point after the first is written in absolute or relative form,
+ * whichever is shorter. Coordinates are formatted like a default-configured
+ * std::ostream would.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam f Number of vertices in the face.
+ *
+ * \param[out] output The stream to write to.
+ * \param[in]  v      The vertices of the face.
+ *
+ * \returns The stream that was passed in.
+ */
+template <typename Q, std::size_t f>
+static std::ostream &path(std::ostream &output,
+                          const std::array<efgy::math::vector<Q, 2>, f> &v) {
+  char abs[64], rel[64];
+
+  std::snprintf(abs, sizeof(abs), "%g,%g", double(v[0][0]), double(v[0][1]));
+  output << "<path d='M" << abs;
+
+  for (std::size_t i = 1; i < f; i++) {
+    std::snprintf(abs, sizeof(abs), "%g,%g", double(v[i][0]),
+                  double(v[i][1]));
+    std::snprintf(rel, sizeof(rel), "%g,%g", double(v[i][0] - v[i - 1][0]),
+                  double(v[i][1] - v[i - 1][1]));
+    if (std::strlen(rel) < std::strlen(abs)) {
+      output << "l" << rel;
+    } else {
+      output << "L" << abs;
+    }
+  }
+
+  return output << "Z'/>";
+}
+
+/**\brief Convert colour for rasteriser
+ *
+ * Converts one of the state's colours to the straight RGBA colour that
+ * topologic::framebuffer works with, clamping components to [0,1].
+ *
+ * \tparam Q Base data type for calculations.
+ *
+ * \param[in] c The colour to convert.
+ *
+ * \returns The colour in the rasteriser's format.
+ */
+template <typename Q>
+static framebuffer::colour
+rasterColour(const efgy::math::vector<Q, 4, efgy::math::format::RGB> &c) {
+  const auto clamp = [](const Q &v) -> float {
+    return float(std::max(Q(0.), std::min(Q(1.), v)));
+  };
+  return {{clamp(c.red), clamp(c.green), clamp(c.blue), clamp(c.alpha)}};
+}
+
+/**\brief Write SVG prologue
+ *
+ * Writes everything that comes before the first face of an SVG: the
+ * document header, the title, the state's metadata and the style sheet.
+ *
+ * \tparam Q Base data type for calculations.
+ * \tparam d Render depth of the state object.
+ *
+ * \param[out] output The stream to write to.
+ * \param[in]  s      The state object to take metadata and colours from.
+ * \param[in]  title  Title of the document, e.g. the model's name.
+ */
+template <typename Q, std::size_t d>
+static void prologue(std::ostream &output, const state<Q, d> &s,
+                     const std::string &title) {
+  output << "<?xml version='1.0' encoding='utf-8'?>"
+            "<svg xmlns='http://www.w3.org/2000/svg'"
+            " xmlns:xlink='http://www.w3.org/1999/xlink'"
+            " version='1.1' width='100%' height='100%' viewBox='-1.2 -1.2 "
+            "2.4 2.4'>"
+            "<title>" +
+                title +
+                "</title>"
+                "<metadata xmlns:t='http://ef.gy/2012/topologic'>"
+         << efgy::xml::tag() << s;
+  output << "</metadata>"
+            "<style type='text/css'>svg { background: rgba("
+         << double(s.background.red) * 100. << "%,"
+         << double(s.background.green) * 100. << "%,"
+         << double(s.background.blue) * 100. << "%,"
+         << double(s.background.alpha)
+         << "); }"
+            " path { stroke-width: 0.002; stroke: rgba("
+         << double(s.wireframe.red) * 100. << "%,"
+         << double(s.wireframe.green) * 100. << "%,"
+         << double(s.wireframe.blue) * 100. << "%,"
+         << double(s.wireframe.alpha) << ");"
+                                              " fill: rgba("
+         << double(s.surface.red) * 100. << "%,"
+         << double(s.surface.green) * 100. << "%,"
+         << double(s.surface.blue) * 100. << "%,"
+         << double(s.surface.alpha) << "); }</style>";
+}
+
 /**\brief Model metadata
  *
  * Holds all the common model metadata that is needed to identify a
@@ -154,6 +525,82 @@ public:
    */
   virtual bool svg(std::ostream &output, bool updateMatrix = false) = 0;
 
+  /**\brief Render to SVG sink
+   *
+   * Produces the same kind of SVG as the stream version, but writes faces
+   * to the given sink as they're generated, without going through the
+   * geometry cache. Use this for models that are too large to keep in
+   * memory. The output is not byte-identical to the stream version:
+   * sink::format() writes coordinates with up to six decimal places, while
+   * path() writes six significant digits.
+   *
+   * \param[out] output       The sink to write to.
+   * \param[in]  updateMatrix Whether to update the projection
+   *                          matrices.
+   *
+   * \returns 'true' upon success.
+   */
+  virtual bool svg(sink &output, bool updateMatrix = false) = 0;
+
+  /**\brief Render to binary mesh
+   *
+   * Writes the model's faces as a binary mesh. The stream starts with a
+   * header, all little-endian: the magic "TMSH", a 32-bit format version
+   * (1), the 64-bit number of vertices, then 32-bit values for the number
+   * of vertices per face, the number of coordinates per vertex, the number
+   * of source coordinates per vertex and the width of each coordinate in
+   * bytes (4 or 8). The vertices follow, face by face, each with its two
+   * projected coordinates and then its source coordinates, if any.
+   *
+   * \param[in] output       The stream to write to.
+   * \param[in] updateMatrix Whether to update the projection
+   *                         matrices.
+   * \param[in] source       Whether to include the coordinates of the
+   *                         vertices before they were projected.
+   *
+   * \returns 'true' upon success.
+   */
+  virtual bool mesh(std::ostream &output, bool updateMatrix = false,
+                    bool source = false) = 0;
+
+  /**\brief Render to bitmap
+   *
+   * Rasterises the model on the CPU, using the state's colours and raster
+   * size, and writes the image as a PPM or PNG. The image is laid out like
+   * the SVG output would be, with the same view box. If fractal flame
+   * colouring is enabled or a number of chaos game samples has been set,
+   * and the model is an IFS, the image is rendered with the chaos game
+   * instead of as polygons.
+   *
+   * \param[out] output       The stream to write to.
+   * \param[in]  updateMatrix Whether to update the projection
+   *                          matrices.
+   * \param[in]  png          Whether to write a PNG instead of a PPM.
+   *
+   * \returns 'true' upon success.
+   */
+  virtual bool raster(std::ostream &output, bool updateMatrix = false,
+                      bool png = false) = 0;
+
+  /**\brief Render to binary point cloud
+   *
+   * Plays the chaos game with the functions of an IFS model and writes the
+   * samples in the same format as mesh(), with one vertex per face. The
+   * number of samples is taken from the state object. Samples are generated
+   * on several threads, but the output doesn't depend on how many there
+   * are.
+   *
+   * \param[in] output       The stream to write to.
+   * \param[in] updateMatrix Whether to update the projection
+   *                         matrices.
+   * \param[in] source       Whether to include the coordinates of the
+   *                         samples before they were projected.
+   *
+   * \returns 'true' upon success, 'false' if the model isn't an IFS.
+   */
+  virtual bool points(std::ostream &output, bool updateMatrix = false,
+                      bool source = false) = 0;
+
 #if !defined(NO_OPENGL)
   /**\brief Render to OpenGL context
    *
@@ -197,6 +644,19 @@ public:
    */
   using stateType = state<Q, modelType::renderDepth>;
 
+  /**\brief Vertex type
+   *
+   * Vertices of the model, in cartesian coordinates in the model's render
+   * depth.
+   */
+  using vertex = efgy::math::vector<Q, modelType::renderDepth>;
+
+  /**\brief Face type
+   *
+   * A single face of the model, as stored in the geometry cache.
+   */
+  using face = std::array<vertex, modelType::faceVertices>;
+
   /**\brief Construct with global state and renderer
    *
    * Sets the object up with a global state object and an
@@ -210,58 +670,254 @@ public:
   wrapper(stateType &pState, const format &pFormat)
       : gState(pState), object(gState.parameter, pFormat),
         base(d, modelType::renderDepth, modelType::id(),
-             modelType::format::id()) {}
+             modelType::format::id()),
+        tolerance(0), detail(0), cached(false) {}
+
+  /**\brief Generate model geometry
+   *
+   * Passes all of the faces of the model, converted to cartesian
+   * coordinates, to the given function, at most batchSize faces at a time.
+   *
+   * The faces are cached, and the cache is only regenerated if the model
+   * parameters that were used to create it have changed, or if the model has
+   * been told to update itself. Changes to the camera positions or
+   * transformation matrices leave the cache intact, so rendering the same
+   * model from a different angle only has to project the cached faces again.
+   *
+   * If the cache needs to be regenerated, the faces are passed on as soon as
+   * the model has generated them, and the cache is dropped as soon as it
+   * would take up more than the state's memory budget. The renderers then
+   * don't hold on to more than a batch of the model's faces at a time, and
+   * the faces are generated again the next time they're needed. The
+   * budget only covers what is kept here, though: the models' own iterators
+   * may still buffer some of their geometry while generating it.
+   *
+   * \tparam F Function type; called with a std::vector<face> batch.
+   *
+   * \param[in] emit  The function to pass the batches of faces to.
+   * \param[in] cache Whether to populate the cache, if it isn't current. If
+   *                  not, the cache is left as it is, so it can still be
+   *                  used once the parameters it was generated with are
+   *                  back.
+   * \param[in] count Whether to add the faces, and the duplicates among
+   *                  them, to the state's statistics if they have to be
+   *                  generated; 'false' if they have been counted before.
+   *
+   * \returns The number of faces that the model has.
+   */
+  template <typename F>
+  std::size_t generate(F emit, bool cache = true, bool count = true) {
+    const std::size_t f = modelType::faceVertices;
+    std::vector<face> batch;
+
+    if (!current()) {
+      if (!cache) {
+        return stream(emit, false, count);
+      }
 
-  bool svg(std::ostream &output, bool updateMatrix = false) {
-    if (metadata::update) {
       metadata::update = false;
+      cached = false;
+      std::vector<face>().swap(faces);
+
+      gState.statistics.time("geometry", [this, count]() {
+        if ((lod() || !load()) && expand(flame::isIFS<modelType>())) {
+          unique(count);
+          if (!lod()) {
+            store();
+          }
+        }
+      });
+
+      if (faces.empty()) {
+        return stream(emit, true, count);
+      }
+
+      if (count) {
+        gState.statistics.faces += faces.size();
+        gState.statistics.vertices += faces.size() * f;
+      }
+
+      parameter = gState.parameter;
+      tolerance = gState.duplicateTolerance;
+      detail = lod() ? gState.lodTolerance : Q(0);
+      cached = true;
     }
 
-    if (updateMatrix) {
-      gState.width = 3;
-      gState.height = 3;
-      gState.updateMatrix();
+    batch.reserve(faces.size() < batchSize ? faces.size() : batchSize);
+    for (std::size_t n = 0; n < faces.size(); n += batchSize) {
+      const std::size_t end = std::min(faces.size(), n + batchSize);
+      batch.assign(faces.begin() + n, faces.begin() + end);
+      emit(batch);
     }
 
-    gState.svg.frameStart();
-
-    output << "<?xml version='1.0' encoding='utf-8'?>"
-              "<svg xmlns='http://www.w3.org/2000/svg'"
-              " xmlns:xlink='http://www.w3.org/1999/xlink'"
-              " version='1.1' width='100%' height='100%' viewBox='-1.2 -1.2 "
-              "2.4 2.4'>"
-              "<title>" +
-                  metadata::name() +
-                  "</title>"
-                  "<metadata xmlns:t='http://ef.gy/2012/topologic'>"
-           << efgy::xml::tag() << gState;
-    output << "</metadata>"
-              "<style type='text/css'>svg { background: rgba("
-           << double(gState.background.red) * 100. << "%,"
-           << double(gState.background.green) * 100. << "%,"
-           << double(gState.background.blue) * 100. << "%,"
-           << double(gState.background.alpha)
-           << "); }"
-              " path { stroke-width: 0.002; stroke: rgba("
-           << double(gState.wireframe.red) * 100. << "%,"
-           << double(gState.wireframe.green) * 100. << "%,"
-           << double(gState.wireframe.blue) * 100. << "%,"
-           << double(gState.wireframe.alpha) << ");"
-                                                " fill: rgba("
-           << double(gState.surface.red) * 100. << "%,"
-           << double(gState.surface.green) * 100. << "%,"
-           << double(gState.surface.blue) * 100. << "%,"
-           << double(gState.surface.alpha) << "); }</style>";
+    return faces.size();
+  }
+
+  /**\brief Get geometry cache key
+   *
+   * Creates the key that the model's geometry is stored under in the
+   * on-disk cache. This is the width of the scalar type, so that runs with
+   * different precisions don't keep replacing each other's files, then the
+   * model-relevant part of the state's canonical command line arguments, as
+   * produced by state::args(), followed by the exact values of the
+   * real-valued parameters, which state::args() rounds.
+   *
+   * \returns The cache key for the model with the current parameters.
+   */
+  std::string cacheKey(void) const {
+    const efgy::geometry::parameters<Q> &p = gState.parameter;
+    std::vector<std::string> v;
+    std::ostringstream key;
+
+    key << "topologic/" << version << " " << sizeof(Q) * 8 << "-bit";
+    for (const auto &arg : gState.state<Q, 1>::args(v)) {
+      if (arg.compare(0, 6, "colour") != 0) {
+        key << " " << arg;
+      }
+    }
+    key << std::hexfloat << " " << double(p.radius) << " " << double(p.radius2)
+        << " " << double(p.constant) << " " << double(p.precision);
+    if (gState.duplicateTolerance > Q(0)) {
+      key << " dedup " << double(gState.duplicateTolerance);
+    }
+
+    return key.str();
+  }
+
+  bool svg(std::ostream &output, bool updateMatrix = false) {
+    prologue(output, updateMatrix);
     if (gState.surface.alpha > Q(0.)) {
-      output << gState.svg << object;
+      const std::size_t f = modelType::faceVertices;
+      std::array<efgy::math::vector<Q, 2>, f> p;
+      std::vector<Q> c;
+      generate([&](const std::vector<face> &batch) {
+        const std::size_t n = projected(batch, c);
+        for (std::size_t v = 0; v < n; v += f) {
+          for (std::size_t i = 0; i < f; i++) {
+            p[i][0] = c[v + i];
+            p[i][1] = c[n + v + i];
+          }
+          path<Q, f>(output, p);
+        }
+      });
     }
     output << "</svg>\n";
 
-    gState.svg.frameEnd();
-
     return true;
   }
 
+  bool svg(sink &output, bool updateMatrix = false) {
+    std::ostringstream header;
+    prologue(header, updateMatrix);
+    output << header.str();
+
+    if (gState.surface.alpha > Q(0.)) {
+      const std::size_t f = modelType::faceVertices;
+      std::array<efgy::math::vector<Q, 2>, f> p;
+      std::vector<Q> c;
+
+      generate([&](const std::vector<face> &batch) {
+        const std::size_t n = projected(batch, c);
+        for (std::size_t v = 0; v < n; v += f) {
+          for (std::size_t i = 0; i < f; i++) {
+            p[i][0] = c[v + i];
+            p[i][1] = c[n + v + i];
+          }
+          output.path(p);
+        }
+      }, false);
+    }
+    output << "</svg>\n";
+
+    return output.flush();
+  }
+
+  bool mesh(std::ostream &output, bool updateMatrix = false,
+            bool source = false) {
+    const std::size_t e = modelType::renderDepth;
+    const std::size_t f = modelType::faceVertices;
+    const std::size_t width = sizeof(Q) == 4 ? 4 : 8;
+
+    setup(updateMatrix);
+
+    const std::size_t faceCount =
+        current() ? faces.size() : generate([](const std::vector<face> &) {});
+    binary out(output);
+
+    out.integer('T', 1).integer('M', 1).integer('S', 1).integer('H', 1);
+    out.integer(1, 4).integer(faceCount * f, 8).integer(f, 4);
+    out.integer(source ? 2 + e : 2, 4).integer(source ? e : 0, 4);
+    out.integer(width, 4);
+
+    std::vector<Q> c;
+    generate([&](const std::vector<face> &batch) {
+      const std::size_t n = projected(batch, c);
+      for (std::size_t v = 0; v < n; v++) {
+        out.real(c[v], width).real(c[n + v], width);
+        if (source) {
+          for (std::size_t k = 0; k < e; k++) {
+            out.real(batch[v / f][v % f][k], width);
+          }
+        }
+      }
+    }, true, false);
+
+    return out.flush();
+  }
+
+  bool raster(std::ostream &output, bool updateMatrix = false,
+              bool png = false) {
+    const std::size_t f = modelType::faceVertices;
+
+    setup(updateMatrix);
+
+    framebuffer image(gState.rasterWidth, gState.rasterHeight,
+                      rasterColour(gState.background));
+    const double scale = double(std::min(image.width, image.height)) / 2.4;
+    const double cx = double(image.width) / 2., cy = double(image.height) / 2.;
+    const double stroke = std::max(1., 0.002 * scale);
+
+    if ((gState.fractalFlameColouring || (gState.samples > 0)) &&
+        chaos(image, scale, cx, cy, flame::isIFS<modelType>())) {
+      return png ? image.png(output) : image.ppm(output);
+    }
+
+    if (gState.surface.alpha > Q(0.)) {
+      const framebuffer::colour surface = rasterColour(gState.surface);
+      const framebuffer::colour wireframe = rasterColour(gState.wireframe);
+      std::array<double, f> x, y;
+      std::vector<Q> c;
+
+      generate([&](const std::vector<face> &batch) {
+        const std::size_t n = projected(batch, c);
+        for (std::size_t v = 0; v < n; v += f) {
+          for (std::size_t i = 0; i < f; i++) {
+            x[i] = cx + double(c[v + i]) * scale;
+            y[i] = cy + double(c[n + v + i]) * scale;
+          }
+          for (std::size_t i = 2; i < f; i++) {
+            image.triangle({{x[0], x[i - 1], x[i]}},
+                           {{y[0], y[i - 1], y[i]}}, surface);
+          }
+          for (std::size_t i = 0; i < f; i++) {
+            image.line(x[i], y[i], x[(i + 1) % f], y[(i + 1) % f], stroke,
+                       wireframe);
+          }
+        }
+        image.render();
+      });
+    }
+
+    return png ? image.png(output) : image.ppm(output);
+  }
+
+  bool points(std::ostream &output, bool updateMatrix = false,
+              bool source = false) {
+    setup(updateMatrix);
+
+    return points(output, source, flame::isIFS<modelType>());
+  }
+
 #if !defined(NO_OPENGL)
   bool opengl(bool updateMatrix = false) {
     if (metadata::update) {
@@ -298,6 +954,528 @@ public:
 #endif
 
 protected:
+  /**\brief Update projection matrices
+   *
+   * Sets the viewport up for the non-interactive renderers and updates the
+   * projection matrices, if requested. Every output call starts here, so
+   * this also drops faces that were refined for a level of detail: the
+   * projection matrices may have changed since they were refined.
+   *
+   * \param[in] updateMatrix Whether to update the projection matrices.
+   */
+  void setup(bool updateMatrix) {
+    if (detail > Q(0)) {
+      cached = false;
+    }
+
+    if (updateMatrix) {
+      gState.statistics.time("updateMatrix", [this]() {
+        gState.width = 3;
+        gState.height = 3;
+        gState.updateMatrix();
+      });
+    }
+  }
+
+  /**\brief Faces per projection batch
+   *
+   * The number of faces that are passed on by generate(), and thus
+   * projected, at once.
+   */
+  static const std::size_t batchSize = 4096;
+
+  /**\brief Project faces to 2D
+   *
+   * Copies the vertices of the given faces into a structure of arrays and
+   * projects all of them in a single batch. If the state object asks for
+   * single precision vertices, the batch is projected in single precision.
+   *
+   * \param[in]  batch The faces to project.
+   * \param[out] c     The X coordinates of all the faces' vertices, in the
+   *                   order they appear in the faces, followed by their Y
+   *                   coordinates.
+   *
+   * \returns The number of vertices that were projected.
+   */
+  std::size_t projected(const std::vector<face> &batch, std::vector<Q> &c) {
+    if (gState.floatVertices && !std::is_same<Q, float>::value) {
+      std::vector<float> b;
+      const std::size_t n = projected(batch, b);
+      c.assign(b.begin(), b.end());
+      return n;
+    }
+
+    return projected<Q>(batch, c);
+  }
+
+  /**\brief Project faces to 2D with the given precision
+   *
+   * \tparam V Data type to project the vertices with.
+   *
+   * \param[in]  batch The faces to project.
+   * \param[out] c     The projected X coordinates, followed by the Y
+   *                   coordinates.
+   *
+   * \returns The number of vertices that were projected.
+   */
+  template <typename V>
+  std::size_t projected(const std::vector<face> &batch, std::vector<V> &c) {
+    const std::size_t e = modelType::renderDepth;
+    const std::size_t f = modelType::faceVertices;
+    const std::size_t n = batch.size() * f;
+
+    c.resize(e * n);
+    for (std::size_t k = 0; k < e; k++) {
+      V *out = c.data() + k * n;
+      for (const auto &g : batch) {
+        for (std::size_t i = 0; i < f; i++) {
+          *out++ = V(g[i][k]);
+        }
+      }
+    }
+
+    project<Q, e>(gState, c, n);
+
+    return n;
+  }
+
+  /**\brief Render fractal flame
+   *
+   * Plays the chaos game with the model's IFS functions and draws the
+   * result into the given image, using the surface and wireframe colours as
+   * the two ends of the colour map.
+   *
+   * \param[in,out] image The image to draw into.
+   * \param[in]     scale Pixels per unit of the projected coordinates.
+   * \param[in]     cx    X coordinate of the image's centre, in pixels.
+   * \param[in]     cy    Y coordinate of the image's centre, in pixels.
+   *
+   * \returns 'true' if the flame was rendered.
+   */
+  bool chaos(framebuffer &image, double scale, double cx, double cy,
+             std::true_type) {
+    const auto projector = [this, scale, cx, cy](const vertex &v, double &x,
+                                                 double &y) {
+      const efgy::math::vector<Q, 2> p =
+          project<Q, modelType::renderDepth>(gState, v);
+      x = cx + double(p[0]) * scale;
+      y = cy + double(p[1]) * scale;
+    };
+
+    return flame::render<Q, modelType::renderDepth>(
+               image, object.functions, projector,
+               std::uint64_t(gState.parameter.seed),
+               rasterColour(gState.surface), rasterColour(gState.wireframe),
+               gState.samples) > 0;
+  }
+
+  /**\brief Write point cloud
+   *
+   * Plays the chaos game with flame::play() in rounds of 64 chunks of 4096
+   * iterations each. The samples of each chunk are collected separately and
+   * written out chunk by chunk, so the output is the same no matter how
+   * many threads there are, and only a single round has to be kept in
+   * memory.
+   *
+   * \param[out] output The stream to write to.
+   * \param[in]  source Whether to include the samples' coordinates before
+   *                    they were projected.
+   *
+   * \returns 'true' if all the samples were written.
+   */
+  bool points(std::ostream &output, bool source, std::true_type) {
+    const std::size_t e = modelType::renderDepth;
+    const std::size_t width = sizeof(Q) == 4 ? 4 : 8;
+    const std::size_t chunk = 1 << 12;
+    const std::size_t chunks = 64;
+    const std::uint64_t total =
+        gState.samples > 0 ? gState.samples : std::uint64_t(1) << 20;
+    const std::uint64_t seed = std::uint64_t(gState.parameter.seed);
+    std::vector<std::vector<vertex>> cloud(chunks);
+    std::vector<Q> c;
+    binary out(output);
+
+    out.integer('T', 1).integer('M', 1).integer('S', 1).integer('H', 1);
+    out.integer(1, 4).integer(total, 8).integer(1, 4);
+    out.integer(source ? 2 + e : 2, 4).integer(source ? e : 0, 4);
+    out.integer(width, 4);
+
+    std::uint64_t written = 0;
+    for (std::size_t round = 0; written < total; round++) {
+      const std::size_t first = round * chunks;
+      for (auto &v : cloud) {
+        v.clear();
+      }
+
+      flame::play<Q, e>(object.functions, seed, first, chunks, chunk, 0,
+                        [&](std::size_t, std::size_t n, const vertex &p,
+                            double) { cloud[n - first].push_back(p); });
+
+      const std::uint64_t before = written;
+      for (const auto &v : cloud) {
+        const std::size_t n = std::size_t(
+            std::min<std::uint64_t>(v.size(), total - written));
+
+        c.resize(e * n);
+        for (std::size_t k = 0; k < e; k++) {
+          for (std::size_t i = 0; i < n; i++) {
+            c[k * n + i] = v[i][k];
+          }
+        }
+        project<Q, e>(gState, c, n);
+
+        for (std::size_t i = 0; i < n; i++) {
+          out.real(c[i], width).real(c[n + i], width);
+          if (source) {
+            for (std::size_t k = 0; k < e; k++) {
+              out.real(v[i][k], width);
+            }
+          }
+        }
+        written += n;
+      }
+
+      if (written == before) {
+        std::cerr << "error: the chaos game did not produce any samples\n";
+        return false;
+      }
+    }
+
+    gState.statistics.vertices += written;
+
+    return out.flush();
+  }
+
+  /**\brief Write point cloud; non-IFS models
+   *
+   * Only IFS models have functions to play the chaos game with.
+   *
+   * \returns 'false', always.
+   */
+  bool points(std::ostream &, bool, std::false_type) {
+    std::cerr << "error: point clouds can only be made of IFS models\n";
+    return false;
+  }
+
+  /**\brief Render fractal flame; non-IFS models
+   *
+   * Models that aren't an IFS have no functions to play the chaos game
+   * with, so this always fails and the model is drawn as polygons instead.
+   *
+   * \returns 'false', always.
+   */
+  bool chaos(framebuffer &, double, double, double, std::false_type) {
+    return false;
+  }
+
+  /**\brief Expand IFS in parallel
+   *
+   * Generates the model with zero, one and two iterations, then uses
+   * ifs::expand() to apply the model's functions for the remaining
+   * iterations on all available threads. The result is only used if the
+   * expansion is able to reproduce the model's own faces for the first two
+   * iterations, so the faces are exactly the same, and in the same order,
+   * as if the model had generated them by itself. Since the expansion
+   * needs the last two iterations in memory at the same time, it is
+   * skipped if those would exceed the state's memory budget.
+   *
+   * With a level of detail tolerance, parts of the model that are smaller
+   * than the tolerance once they've been projected aren't expanded any
+   * further; see ifs::refine().
+   *
+   * \returns 'true' if the geometry cache was populated, 'false' if the
+   *          model has to generate its faces by itself.
+   */
+  bool expand(std::true_type) {
+    const std::size_t iterations = std::size_t(gState.parameter.iterations);
+    if (iterations <= 2) {
+      return false;
+    }
+
+    efgy::geometry::parameters<Q> p0 = gState.parameter, p1 = p0, p2 = p0;
+    p0.iterations = 0;
+    p1.iterations = 1;
+    p2.iterations = 2;
+    modelType m0(p0, format()), m1(p1, format()), m2(p2, format());
+    std::vector<face> base, one, two;
+    collect(m0, base);
+    collect(m1, one);
+    collect(m2, two);
+
+    if (lod()) {
+      const Q tolerance = gState.lodTolerance;
+      const auto finished = [this, tolerance](
+          const std::array<vertex, modelType::renderDepth + 1> &m) -> bool {
+        efgy::math::vector<Q, 2> lo = project<Q, modelType::renderDepth>(
+                                     gState, m[0]),
+                                 hi = lo;
+        for (std::size_t i = 1; i < m.size(); i++) {
+          const efgy::math::vector<Q, 2> p =
+              project<Q, modelType::renderDepth>(gState, m[i]);
+          for (std::size_t c = 0; c < 2; c++) {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+          }
+        }
+        return (hi[0] - lo[0] < tolerance) && (hi[1] - lo[1] < tolerance);
+      };
+
+      return ifs::refine(faces, base, one, two, m0.functions, iterations,
+                         finished, gState.maxMemory);
+    }
+
+    return ifs::expand(faces, base, one, two, m0.functions, iterations,
+                       gState.maxMemory);
+  }
+
+  /**\brief Expand IFS in parallel; non-IFS models
+   *
+   * Models that aren't an IFS have no functions to expand, so they always
+   * generate their faces by themselves.
+   *
+   * \returns 'false', always.
+   */
+  bool expand(std::false_type) { return false; }
+
+  /**\brief Collect faces
+   *
+   * Converts all the faces of the given model instance to cartesian
+   * coordinates.
+   *
+   * \param[in]  model The model instance to collect the faces of.
+   * \param[out] out   Where to append the faces to.
+   */
+  static void collect(modelType &model, std::vector<face> &out) {
+    for (const auto &f : model) {
+      face g;
+      for (std::size_t i = 0; i < modelType::faceVertices; i++) {
+        g[i] = f[i];
+      }
+      out.push_back(g);
+    }
+  }
+
+  /**\brief Write SVG prologue
+   *
+   * Updates the projection matrices, if requested, then writes everything
+   * that comes before the first face of an SVG.
+   *
+   * \param[out] output       The stream to write to.
+   * \param[in]  updateMatrix Whether to update the projection
+   *                          matrices.
+   */
+  void prologue(std::ostream &output, bool updateMatrix) {
+    setup(updateMatrix);
+    render::prologue(output, gState, metadata::name());
+  }
+
+  /**\brief Is the geometry cache current?
+   *
+   * Faces that were refined for a level of detail depend on the projection
+   * matrices, so setup() drops them at the start of every output call; they
+   * are only current for the rest of the call that refined them.
+   *
+   * \returns 'true' if the geometry cache has been populated with the
+   *          current model parameters, 'false' otherwise.
+   */
+  bool current(void) const {
+    return !metadata::update && cached && sameParameters() &&
+           (tolerance == gState.duplicateTolerance) &&
+           (detail == (lod() ? gState.lodTolerance : Q(0)));
+  }
+
+  /**\brief Use level of detail?
+   *
+   * Only IFS models support a level of detail, and their faces then depend
+   * on the projection matrices, so they're neither taken from nor written
+   * to the on-disk cache, and the geometry cache is only current within a
+   * single output call.
+   *
+   * \returns 'true' if the model's faces are generated with a level of
+   *          detail tolerance.
+   */
+  bool lod(void) const {
+    return flame::isIFS<modelType>::value && (gState.lodTolerance > Q(0));
+  }
+
+  /**\brief Generate faces from model
+   *
+   * Iterates over the model's faces and passes them on in batches, keeping
+   * a copy in the geometry cache until it grows beyond the state's memory
+   * budget. Only the time spent in the model counts towards the
+   * "geometry" phase, not the time spent in the given function.
+   *
+   * \tparam F Function type; called with a std::vector<face> batch.
+   *
+   * \param[in] emit  The function to pass the batches of faces to.
+   * \param[in] cache Whether to populate the cache.
+   * \param[in] count Whether to add the faces, and the duplicates among
+   *                  them, to the state's statistics.
+   *
+   * \returns The number of faces that the model has.
+   */
+  template <typename F>
+  std::size_t stream(F emit, bool cache, bool count) {
+    const std::size_t f = modelType::faceVertices;
+    const std::size_t budget = gState.maxMemory;
+    const double wall = stats::wall(), cpu = stats::cpu();
+    double emitWall = 0., emitCPU = 0.;
+    const bool filter = gState.duplicateTolerance > Q(0);
+    dedup<Q, modelType::renderDepth, f> duplicates(gState.duplicateTolerance);
+    std::vector<face> batch;
+    std::size_t n = 0;
+
+    const auto flush = [&]() {
+      const double w = stats::wall(), c = stats::cpu();
+      emit(batch);
+      batch.clear();
+      emitWall += stats::wall() - w;
+      emitCPU += stats::cpu() - c;
+    };
+
+    batch.reserve(batchSize);
+    for (const auto &g : object) {
+      face h;
+      for (std::size_t i = 0; i < f; i++) {
+        h[i] = g[i];
+      }
+      if (filter && !duplicates.insert(h)) {
+        continue;
+      }
+      if (cache) {
+        faces.push_back(h);
+        if ((budget > 0) && (faces.capacity() * sizeof(face) > budget)) {
+          std::vector<face>().swap(faces);
+          cache = false;
+        }
+      }
+      batch.push_back(h);
+      n++;
+      if (batch.size() == batchSize) {
+        flush();
+      }
+    }
+    if (!batch.empty()) {
+      flush();
+    }
+
+    gState.statistics.add("geometry", stats::wall() - wall - emitWall,
+                          stats::cpu() - cpu - emitCPU);
+    if (count) {
+      gState.statistics.faces += n;
+      gState.statistics.vertices += n * f;
+      gState.statistics.duplicates += duplicates.removed;
+    }
+
+    if (cache) {
+      parameter = gState.parameter;
+      tolerance = gState.duplicateTolerance;
+      detail = Q(0);
+      cached = true;
+      store();
+    }
+
+    return n;
+  }
+
+  /**\brief Remove duplicate faces
+   *
+   * Removes faces from the geometry cache that are the same as an earlier
+   * face, up to the state's duplicate tolerance, if there is one.
+   *
+   * \param[in] count Whether to add the number of duplicates to the
+   *                  state's statistics.
+   */
+  void unique(bool count) {
+    if (gState.duplicateTolerance > Q(0)) {
+      dedup<Q, modelType::renderDepth, modelType::faceVertices> duplicates(
+          gState.duplicateTolerance);
+      duplicates.filter(faces);
+      if (count) {
+        gState.statistics.duplicates += duplicates.removed;
+      }
+    }
+  }
+
+  /**\brief Load geometry from on-disk cache
+   *
+   * Tries to populate the geometry cache from the on-disk cache, if there
+   * is a cache directory.
+   *
+   * \returns 'true' if the geometry was loaded from the on-disk cache.
+   */
+  bool load(void) {
+    const std::size_t e = modelType::renderDepth;
+    const std::size_t f = modelType::faceVertices;
+
+    if (gState.cacheDirectory == "") {
+      return false;
+    }
+
+    return cache::load<Q>(gState.cacheDirectory, cacheKey(), e, f,
+                          [this](const Q *data, std::size_t count) {
+      faces.resize(count);
+      for (std::size_t n = 0, i = 0; n < count; n++) {
+        for (std::size_t j = 0; j < f; j++) {
+          for (std::size_t k = 0; k < e; k++, i++) {
+            faces[n][j][k] = data[i];
+          }
+        }
+      }
+    });
+  }
+
+  /**\brief Store geometry in on-disk cache
+   *
+   * Writes the contents of the geometry cache to the on-disk cache, if there
+   * is a cache directory.
+   *
+   * \returns 'true' if the geometry was written to the on-disk cache.
+   */
+  bool store(void) const {
+    std::vector<Q> data;
+    const std::size_t e = modelType::renderDepth;
+    const std::size_t f = modelType::faceVertices;
+
+    if (gState.cacheDirectory == "") {
+      return false;
+    }
+
+    data.reserve(faces.size() * e * f);
+    for (const auto &g : faces) {
+      for (std::size_t j = 0; j < f; j++) {
+        for (std::size_t k = 0; k < e; k++) {
+          data.push_back(g[j][k]);
+        }
+      }
+    }
+
+    return cache::store(gState.cacheDirectory, cacheKey(), e, f, data,
+                        gState.cacheSize);
+  }
+
+  /**\brief Compare model parameters with cache
+   *
+   * Checks whether the model parameters in the global state object are the
+   * same as the ones that the geometry cache was generated with.
+   *
+   * \returns 'true' if the parameters that the models make use of are the
+   *          same, 'false' otherwise.
+   */
+  bool sameParameters(void) const {
+    const efgy::geometry::parameters<Q> &p = gState.parameter;
+    return (p.radius == parameter.radius) &&
+           (p.radius2 == parameter.radius2) &&
+           (p.constant == parameter.constant) &&
+           (p.precision == parameter.precision) &&
+           (p.iterations == parameter.iterations) &&
+           (p.functions == parameter.functions) &&
+           (p.seed == parameter.seed) &&
+           (p.preRotate == parameter.preRotate) &&
+           (p.postRotate == parameter.postRotate) &&
+           (p.flameCoefficients == parameter.flameCoefficients);
+  }
+
   /**\brief Global state object
    *
    * A reference to the global state object, which was passed to
@@ -312,6 +1490,40 @@ protected:
    * trying to create a representation of.
    */
   modelType object;
+
+  /**\brief Geometry cache
+   *
+   * The faces of the model, as generated by the last call to generate(),
+   * unless they took up more memory than the state allows.
+   */
+  std::vector<face> faces;
+
+  /**\brief Geometry cache parameters
+   *
+   * A copy of the model parameters that the geometry cache was generated
+   * with.
+   */
+  efgy::geometry::parameters<Q> parameter;
+
+  /**\brief Geometry cache duplicate tolerance
+   *
+   * The duplicate tolerance that the geometry cache was generated with.
+   */
+  Q tolerance;
+
+  /**\brief Geometry cache level of detail
+   *
+   * The level of detail tolerance that the faces in the geometry cache were
+   * refined with, or 0 if they weren't.
+   */
+  Q detail;
+
+  /**\brief Is the geometry cache valid?
+   *
+   * Set once the geometry cache has been populated for the first time.
+   */
+  bool cached;
+
 };
 }
 }
@@ -0,0 +1,325 @@
+/**\file
+ * \brief Render server
+ *
+ * Starting a new process for every render request is more expensive than
+ * rendering small models. The server in this file keeps a pool of worker
+ * threads with warm state objects and models around instead, and accepts
+ * requests over a Unix domain socket.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_SERVER_H)
+#define TOPOLOGIC_SERVER_H
+
+#include <topologic/batch.h>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <thread>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace topologic {
+/**\brief Render server
+ *
+ * Listens on a Unix domain socket and renders one request per connection.
+ * A request is a single line, terminated by a newline or by the client
+ * shutting down its end of the connection, that contains either a list of
+ * arguments in the same format as those accepted on the command line or a
+ * JSON state document - i.e. a batch manifest line without the output file
+ * name. The rendered output is sent back and the connection is closed; if
+ * the request can't be rendered, the connection is closed without sending
+ * anything.
+ *
+ * Connections are handled by a fixed number of worker threads, each with
+ * its own state object, which is reset for every request but keeps its
+ * model if the next request uses the same one. Accepted connections wait in
+ * a bounded queue; once that's full, the server stops accepting connections
+ * until a worker is free, so further clients queue up in the kernel's
+ * listen backlog instead.
+ *
+ * Clients that don't send their request, or don't take their result, within
+ * a timeout are disconnected, so they can't hold on to a worker forever.
+ * The workers take the cache directory, the cache and memory budgets and
+ * the statistics settings from the state object that the server was
+ * started with, and requests can't change them or read files; see
+ * prepare(). Statistics are kept per request: if the server was started
+ * with them, they are written to stderr once each request has been
+ * rendered, and every request starts with a clean slate.
+ *
+ * \tparam Q   Base data type for calculations.
+ * \tparam dim Maximum render depth of the state objects.
+ */
+template <typename Q, std::size_t dim> class server {
+public:
+  /**\brief Maximum size of a request, in bytes */
+  static const std::size_t maxRequest = 1 << 20;
+
+  /**\brief Socket timeout, in seconds
+   *
+   * How long a worker waits for a client to send more of its request, or to
+   * take more of the result, before giving up on the connection.
+   */
+  static const int timeout = 10;
+
+  /**\brief Construct with options and settings
+   *
+   * \param[in,out] pOptions Compiled command line options to use.
+   * \param[in]     pState   State object that the server was started with;
+   *                         the workers take its process settings.
+   * \param[in]     pThreads Number of worker threads; 0 to use as many
+   *                         threads as there are hardware threads.
+   * \param[in]     pOut     Output mode for requests that don't specify one.
+   */
+  server(arguments<Q, dim> &pOptions, const state<Q, dim> &pState,
+         std::size_t pThreads, enum outputMode pOut)
+      : options(pOptions), out(pOut) {
+    if (pThreads == 0) {
+      pThreads = std::thread::hardware_concurrency();
+    }
+    if (pThreads == 0) {
+      pThreads = 1;
+    }
+
+    for (std::size_t i = 0; i < pThreads; i++) {
+      states.emplace_back(new state<Q, dim>());
+      states.back()->inherit(pState);
+    }
+    capacity = pThreads * 4;
+  }
+
+  /**\brief Run server
+   *
+   * Creates the socket and serves requests on it. A stale socket left over
+   * from an earlier run is replaced, but other kinds of files aren't.
+   *
+   * \param[in] path Where to create the socket.
+   *
+   * \returns 'false' if the socket could not be set up; otherwise this
+   *          function doesn't return unless accepting connections fails.
+   */
+  bool run(const std::string &path) {
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+      std::cerr << "error: socket path is too long: " << path << "\n";
+      return false;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    struct stat st;
+    if ((lstat(path.c_str(), &st) == 0) && S_ISSOCK(st.st_mode)) {
+      unlink(path.c_str());
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((listener < 0) ||
+        (::bind(listener, (struct sockaddr *)&address, sizeof(address)) !=
+         0) ||
+        (listen(listener, 64) != 0)) {
+      std::cerr << "error: could not listen on " << path << ": "
+                << std::strerror(errno) << "\n";
+      if (listener >= 0) {
+        close(listener);
+      }
+      return false;
+    }
+
+    std::vector<std::thread> workers;
+    for (auto &s : states) {
+      state<Q, dim> *topologicState = s.get();
+      workers.emplace_back([this, topologicState]() { work(*topologicState); });
+    }
+
+    bool rv = true;
+    while (rv) {
+      int client = accept(listener, 0, 0);
+      if (client < 0) {
+        rv = (errno == EINTR) || (errno == ECONNABORTED);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> l(queueLock);
+      space.wait(l, [this]() { return pending.size() < capacity; });
+      pending.push_back(client);
+      ready.notify_one();
+    }
+
+    std::cerr << "error: could not accept connections: "
+              << std::strerror(errno) << "\n";
+
+    {
+      std::lock_guard<std::mutex> l(queueLock);
+      pending.push_back(-1);
+      ready.notify_all();
+    }
+    for (auto &t : workers) {
+      t.join();
+    }
+
+    close(listener);
+    unlink(path.c_str());
+
+    return false;
+  }
+
+protected:
+  /**\brief Worker thread
+   *
+   * Takes connections from the queue and serves them, until a connection of
+   * -1 is queued, which makes all of the workers stop.
+   *
+   * \param[in,out] topologicState The worker's state object.
+   */
+  void work(state<Q, dim> &topologicState) {
+    while (true) {
+      int client;
+      {
+        std::unique_lock<std::mutex> l(queueLock);
+        ready.wait(l, [this]() { return !pending.empty(); });
+        client = pending.front();
+        if (client < 0) {
+          return;
+        }
+        pending.pop_front();
+        space.notify_one();
+      }
+
+      serve(client, topologicState);
+      close(client);
+    }
+  }
+
+  /**\brief Serve request
+   *
+   * Reads a request from the given connection, renders it and sends back
+   * the result.
+   *
+   * \param[in]     client         The connection to serve.
+   * \param[in,out] topologicState The state object to render with.
+   *
+   * \returns 'true' if the request was served successfully.
+   */
+  bool serve(int client, state<Q, dim> &topologicState) {
+    std::string request;
+    char buffer[4096];
+
+    struct timeval t;
+    t.tv_sec = timeout;
+    t.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &t, sizeof(t));
+
+    while (request.find('\n') == std::string::npos) {
+      ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+      if ((n < 0) && (errno == EINTR)) {
+        continue;
+      }
+      if (n < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+          std::cerr << "error: timed out waiting for request\n";
+        }
+        return false;
+      }
+      if (n == 0) {
+        break;
+      }
+      request.append(buffer, n);
+      if (request.size() > maxRequest) {
+        std::cerr << "error: request is too large\n";
+        return false;
+      }
+    }
+
+    job j;
+    if (!j.read("- " + request.substr(0, request.find('\n')))) {
+      return false;
+    }
+
+    enum outputMode o = out;
+    bool ok;
+    {
+      std::lock_guard<std::mutex> l(optionsLock);
+      options.bind(topologicState);
+      ok = prepare(options, topologicState, j, o, true);
+    }
+
+    std::ostringstream result;
+    ok = ok && write(result, topologicState, o);
+
+    stats &statistics = topologicState.statistics;
+    if (statistics.enabled) {
+      std::ostringstream report;
+      statistics.json(report);
+      std::cerr << report.str();
+    }
+    statistics.clear();
+
+    if (!ok) {
+      return false;
+    }
+
+    const std::string data = result.str();
+    for (std::size_t i = 0; i < data.size();) {
+      ssize_t n = send(client, data.data() + i, data.size() - i, MSG_NOSIGNAL);
+      if ((n < 0) && (errno == EINTR)) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      i += n;
+    }
+
+    return true;
+  }
+
+  /**\brief Compiled command line options
+   *
+   * Shared by all of the workers, but only used by one at a time.
+   */
+  arguments<Q, dim> &options;
+
+  /**\brief Lock for the compiled options */
+  std::mutex optionsLock;
+
+  /**\brief Output mode for requests that don't specify one */
+  const enum outputMode out;
+
+  /**\brief The workers' state objects */
+  std::vector<std::unique_ptr<state<Q, dim>>> states;
+
+  /**\brief Accepted connections that haven't been served yet */
+  std::deque<int> pending;
+
+  /**\brief Maximum number of pending connections */
+  std::size_t capacity;
+
+  /**\brief Lock for the pending connections */
+  std::mutex queueLock;
+
+  /**\brief Signalled when a connection has been queued */
+  std::condition_variable ready;
+
+  /**\brief Signalled when a queued connection has been taken */
+  std::condition_variable space;
+};
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include <ef.gy/render-svg.h>
 #include <ef.gy/render-json.h>
 #include <ef.gy/render-css.h>
+#include <cmath>
 #include <sstream>
 #include <type_traits>
 
@@ -76,7 +77,59 @@ enum outputMode {
    * Output is supposed to be a set of arguments, which could be passed to the
    * command line topologic binary.
    */
-  outArguments = 5
+  outArguments = 5,
+
+  /**\brief Binary mesh label
+   *
+   * Output is a compact, little-endian binary stream of the projected 2D
+   * vertices of all of the model's faces, meant for consumption by other
+   * programmes rather than people.
+   */
+  outMesh = 6,
+
+  /**\brief Binary mesh label, with source coordinates
+   *
+   * Like outMesh, but each vertex also includes its coordinates in the
+   * model's render depth, before they were projected to 2D.
+   */
+  outMeshFull = 7,
+
+  /**\brief Streaming SVG renderer label
+   *
+   * Produces the same kind of SVG as outSVG, but faces are projected and
+   * written out as they're generated, in large chunks, instead of going
+   * through the geometry cache. Memory use stays the same no matter how
+   * many faces a model has.
+   */
+  outSVGStream = 8,
+
+  /**\brief PPM raster label
+   *
+   * Renders the model into a bitmap on the CPU, without needing an OpenGL
+   * context, and writes the result as a binary PPM.
+   */
+  outPPM = 9,
+
+  /**\brief PNG raster label
+   *
+   * Like outPPM, but the result is written as an RGBA PNG.
+   */
+  outPNG = 10,
+
+  /**\brief Binary point cloud label
+   *
+   * Plays the chaos game with the functions of an IFS model and writes the
+   * projected samples as a point cloud, in the same binary format as
+   * outMesh, with one vertex per face.
+   */
+  outPoints = 11,
+
+  /**\brief Binary point cloud label, with source coordinates
+   *
+   * Like outPoints, but each sample also includes its coordinates in the
+   * model's render depth, before they were projected to 2D.
+   */
+  outPointsFull = 12
 };
 
 /**\brief Topologic global programme state object
@@ -132,19 +185,9 @@ public:
 #if !defined(NO_OPENGL)
         opengl(transformation, projection, state<Q, d - 1>::opengl),
 #endif
-        svg(transformation, projection, state<Q, d - 1>::svg), active(d == 3) {
-    if (d == 3) {
-      fromp[0] = 3;
-      fromp[1] = 1;
-      fromp[2] = 1;
-    } else {
-      fromp[0] = 2;
-      for (int i = 1; i < d; i++) {
-        fromp[i] = 1.57;
-      }
-    }
-  
-    from = fromp;
+        svg(transformation, projection, state<Q, d - 1>::svg), active(d == 3),
+        polarMatrix(true) {
+    reset();
   }
 
   /**\brief Polar 'from' point
@@ -177,6 +220,25 @@ public:
    */
   typename efgy::geometry::projection<Q, d> projection;
 
+  /**\brief Does the projection matrix need to be updated?
+   *
+   * Set whenever the camera of this dimension is modified, so that
+   * updateMatrix() only recalculates the projection matrices that are out
+   * of date. Code that modifies 'from' or 'fromp' directly needs to set
+   * this flag as well.
+   */
+  bool dirty;
+
+  /**\brief Use an orthographic projection?
+   *
+   * If set, the projection matrix of this dimension drops the depth
+   * coordinate instead of dividing by it. That makes the projection
+   * linear, with the model scaled so that the origin appears the same size
+   * as with the default perspective projection. Use setOrthographic() to
+   * modify this flag, so that the matrix gets updated.
+   */
+  bool orthographic;
+
   /**\brief Viewport transformation matrix
    *
    * An affine transformation which is applied to any vectors being drawn
@@ -200,24 +262,96 @@ public:
   typename efgy::render::opengl<Q, d> opengl;
 #endif
 
+  /**\brief Reset to defaults
+   *
+   * Restores the camera position and transformation matrix of this dimension
+   * to the values set by the default constructor, then does the same for all
+   * the lower dimensions. The model is left alone, so this can be used to
+   * start from a clean slate without having to regenerate the model.
+   *
+   * \returns 'true' when all the dimensions have been reset.
+   */
+  bool reset(void) {
+    if (d == 3) {
+      fromp[0] = 3;
+      fromp[1] = 1;
+      fromp[2] = 1;
+    } else {
+      fromp[0] = 2;
+      for (int i = 1; i < d; i++) {
+        fromp[i] = 1.57;
+      }
+    }
+
+    from = fromp;
+    transformation = efgy::geometry::transformation::affine<Q, d>();
+    orthographic = false;
+    dirty = true;
+
+    return state<Q, d - 1>::reset();
+  }
+
   /**\brief Update projection matrices
    *
    * Resets the projection matrix's parameters and forces it to be updated
    * with the new parameters, then keeps doing so recursively for all its
-   * parent classes.
+   * parent classes. Dimensions whose camera, aspect ratio and coordinate
+   * mode haven't changed since the last update are skipped. The affine
+   * transformation isn't part of the projection matrix, so rotating or
+   * scaling a model doesn't make it dirty.
    *
    * \returns 'true' when matrices have been updated successfully.
    */
   bool updateMatrix(void) {
-    projection.aspect =
-        (d == 3) ? Q(base::width) / Q(base::height) : Q(1);
-    if (base::polarCoordinates) {
-      from = fromp;
+    const Q aspect = (d == 3) ? Q(base::width) / Q(base::height) : Q(1);
+    if (dirty || (projection.aspect != aspect) ||
+        (polarMatrix != base::polarCoordinates)) {
+      projection.aspect = aspect;
+      if (base::polarCoordinates) {
+        from = fromp;
+      }
+      projection.updateMatrix();
+      if (orthographic) {
+        flatten();
+      }
+      polarMatrix = base::polarCoordinates;
+      dirty = false;
     }
-    projection.updateMatrix();
     return state<Q, d - 1>::updateMatrix();
   }
 
+  /**\brief Set projection mode
+   *
+   * Switches the projection of the given dimension, or of all of the
+   * dimensions, between perspective and orthographic.
+   *
+   * \param[in] value     Whether to use an orthographic projection.
+   * \param[in] dimension Target render dimension, or 0 for all of them.
+   *
+   * \returns 'true' if the projection modes were updated successfully.
+   */
+  bool setOrthographic(const bool &value, const std::size_t &dimension) {
+    if ((dimension == 0) || (dimension == d)) {
+      dirty = dirty || (orthographic != value);
+      orthographic = value;
+    }
+
+    return state<Q, d - 1>::setOrthographic(value, dimension);
+  }
+
+  /**\brief Invalidate projection matrices
+   *
+   * Marks the projection matrices of this and all the lower dimensions as
+   * dirty, so that the next call to updateMatrix() recalculates all of
+   * them.
+   *
+   * \returns 'true' when all the matrices have been marked as dirty.
+   */
+  bool invalidateMatrix(void) {
+    dirty = true;
+    return state<Q, d - 1>::invalidateMatrix();
+  }
+
   bool invalidateCache(void) {
 #if !defined(NO_OPENGL)
 #if defined(TRANSFORM_4D_IN_PIXEL_SHADER)
@@ -377,6 +511,7 @@ public:
     }
 
     invalidateCache();
+    dirty = true;
 
     if (base::polarCoordinates) {
       fromp[coord] = value;
@@ -443,6 +578,7 @@ public:
    */
   bool translatePolarToCartesian(void) {
     from = fromp;
+    dirty = true;
     return state<Q, d - 1>::translatePolarToCartesian();
   }
 
@@ -457,6 +593,7 @@ public:
    */
   bool translateCartesianToPolar(void) {
     fromp = from;
+    dirty = true;
     return state<Q, d - 1>::translateCartesianToPolar();
   }
 
@@ -499,6 +636,10 @@ public:
       value("transformation").push(v);
     }
 
+    if (orthographic) {
+      value("orthographic").push(Q(d));
+    }
+
     return value;
   }
 
@@ -562,6 +703,11 @@ public:
       s.str("");
     }
 
+    if (orthographic) {
+      s << "orthographic:" << d;
+      value.push_back(s.str());
+    }
+
     return value;
   }
 
@@ -576,6 +722,39 @@ protected:
    * You should only set this flag with the setActive() method.
    */
   bool active;
+
+  /**\brief Coordinate mode of the projection matrix
+   *
+   * The value that base::polarCoordinates had when the projection matrix
+   * was last updated; the camera position depends on it.
+   */
+  bool polarMatrix;
+
+  /**\brief Make projection matrix orthographic
+   *
+   * Replaces the projection matrix with one that only moves the camera to
+   * the origin, looking along the last axis, then drops the depth and scales
+   * the result like the perspective projection would at the origin.
+   */
+  void flatten(void) {
+    const efgy::geometry::lookAt<Q, d> lookAt(from, to);
+    Q distance = Q(0);
+    for (std::size_t i = 0; i < d; i++) {
+      distance += (from[i] - to[i]) * (from[i] - to[i]);
+    }
+    const Q scale = Q(1) / (std::tan(Q(M_PI_4) / Q(2)) * std::sqrt(distance));
+
+    for (std::size_t i = 0; i <= d; i++) {
+      for (std::size_t j = 0; j <= d; j++) {
+        if (j < d - 1) {
+          projection.matrix[i][j] = lookAt.matrix[i][j] * scale /
+                                    (j == 0 ? projection.aspect : Q(1));
+        } else {
+          projection.matrix[i][j] = Q(i == j && j == d);
+        }
+      }
+    }
+  }
 };
 
 /**\brief Topologic programme state (1D fix point)
@@ -604,7 +783,50 @@ public:
 #endif
         background(Q(1), Q(1), Q(1), Q(1)), wireframe(Q(0), Q(0), Q(0), Q(0.8)),
         surface(Q(0), Q(0), Q(0), Q(0.2)), fractalFlameColouring(false),
-        model(0) {
+        rasterWidth(512), rasterHeight(512), cacheDirectory(""),
+        cacheSize(std::size_t(256) << 20), maxMemory(0), lodTolerance(0),
+        samples(0), duplicateTolerance(0), floatVertices(false), model(0) {
+    reset();
+  }
+
+  /**\brief Destructor
+   *
+   * Deletes the model instance, if it exists.
+   */
+  ~state(void) {
+    if (model) {
+      delete model;
+      model = 0;
+    }
+  }
+
+  /**\brief Reset to defaults; 1D fix point
+   *
+   * Restores the model parameters, colours and flags to the values that a
+   * default-constructed state object would have, so that nothing that
+   * affects the output carries over from one job to the next. The model
+   * itself is not touched, and neither are the cache directory, the cache
+   * and memory budgets and the statistics, which belong to the process.
+   *
+   * \returns 'true' because resetting these values cannot fail.
+   */
+  bool reset(void) {
+    polarCoordinates = true;
+    background = efgy::math::vector<Q, 4, efgy::math::format::RGB>(
+        Q(1), Q(1), Q(1), Q(1));
+    wireframe = efgy::math::vector<Q, 4, efgy::math::format::RGB>(
+        Q(0), Q(0), Q(0), Q(0.8));
+    surface = efgy::math::vector<Q, 4, efgy::math::format::RGB>(
+        Q(0), Q(0), Q(0), Q(0.2));
+    fractalFlameColouring = false;
+    rasterWidth = 512;
+    rasterHeight = 512;
+    lodTolerance = Q(0);
+    samples = 0;
+    duplicateTolerance = Q(0);
+    floatVertices = false;
+
+    parameter = efgy::geometry::parameters<Q>();
     parameter.radius = Q(1);
     parameter.precision = Q(10);
     parameter.iterations = 4;
@@ -613,17 +835,25 @@ public:
     parameter.preRotate = true;
     parameter.postRotate = false;
     parameter.flameCoefficients = 3;
+
+    return true;
   }
 
-  /**\brief Destructor
+  /**\brief Copy process settings
    *
-   * Deletes the model instance, if it exists.
+   * Copies the settings that reset() keeps, because they belong to the
+   * process rather than to a job, from the given state object: the cache
+   * directory, the cache and memory budgets and whether statistics are
+   * reported. Used to set up the state objects of worker threads.
+   *
+   * \param[in] s The state object to copy the settings from.
    */
-  ~state(void) {
-    if (model) {
-      delete model;
-      model = 0;
-    }
+  void inherit(const state<Q, 1> &s) {
+    cacheDirectory = s.cacheDirectory;
+    cacheSize = s.cacheSize;
+    maxMemory = s.maxMemory;
+    statistics.enabled = s.statistics.enabled;
+    statistics.metadata = s.statistics.metadata;
   }
 
   /**\brief Update projection matrices; 1D fix point
@@ -638,6 +868,24 @@ public:
    */
   constexpr bool updateMatrix(void) const { return true; }
 
+  /**\brief Invalidate projection matrices; 1D fix point
+   *
+   * There's no 1D projection matrix, so there's nothing to invalidate.
+   *
+   * \returns 'true' because this can't fail.
+   */
+  constexpr bool invalidateMatrix(void) const { return true; }
+
+  /**\brief Set projection mode; 1D fix point
+   *
+   * There's no 1D projection, so there's nothing to set.
+   *
+   * \returns 'true' because this can't fail.
+   */
+  constexpr bool setOrthographic(const bool &, const std::size_t &) const {
+    return true;
+  }
+
   /**\brief Apply scale; 1D fix point
    *
    * Applies a scale to the affine transformation matrix; since the 1D
@@ -765,6 +1013,11 @@ public:
     value("preRotate") = parameter.preRotate;
     value("postRotate") = parameter.postRotate;
     value("flameCoefficients") = Q(parameter.flameCoefficients);
+    value("rasterWidth") = Q(rasterWidth);
+    value("rasterHeight") = Q(rasterHeight);
+    value("lodTolerance") = lodTolerance;
+    value("samples") = Q(samples);
+    value("duplicateTolerance") = duplicateTolerance;
 
     value("background").toArray();
     value("wireframe").toArray();
@@ -850,6 +1103,30 @@ public:
       s.str("");
     }
 
+    if (lodTolerance > Q(0)) {
+      s << "lod:" << lodTolerance;
+      value.push_back(s.str());
+      s.str("");
+    }
+
+    if (samples > 0) {
+      s << "samples:" << samples;
+      value.push_back(s.str());
+      s.str("");
+    }
+
+    if (duplicateTolerance > Q(0)) {
+      s << "dedup:" << duplicateTolerance;
+      value.push_back(s.str());
+      s.str("");
+    }
+
+    if ((rasterWidth != 512) || (rasterHeight != 512)) {
+      s << "size:" << rasterWidth << "x" << rasterHeight;
+      value.push_back(s.str());
+      s.str("");
+    }
+
     if (fractalFlameColouring) {
       value.push_back("colour:fractal-flame");
     } else {
@@ -967,6 +1244,99 @@ public:
    *      describing this colouring algorithm.
    */
   bool fractalFlameColouring;
+
+  /**\brief Raster image width
+   *
+   * Width, in pixels, of the images produced by the raster output modes.
+   */
+  std::size_t rasterWidth;
+
+  /**\brief Raster image height
+   *
+   * Height, in pixels, of the images produced by the raster output modes.
+   */
+  std::size_t rasterHeight;
+
+  /**\brief Geometry cache directory
+   *
+   * The directory that generated model geometry is cached in, so that it can
+   * be reused by later processes. Empty if geometry should not be cached on
+   * disk, which is the default.
+   *
+   * \note Unlike most other settings, this is not reset by reset(), as it
+   *       is not part of the model or how it is rendered.
+   */
+  std::string cacheDirectory;
+
+  /**\brief Geometry cache budget
+   *
+   * The maximum total size, in bytes, of all the files in the geometry cache
+   * directory. The least recently used files are deleted whenever the cache
+   * exceeds this size. Defaults to 256 MiB.
+   */
+  std::size_t cacheSize;
+
+  /**\brief Geometry memory budget
+   *
+   * The maximum size, in bytes, of the model faces that the renderers keep
+   * in memory. Models with more faces than that are generated in batches,
+   * straight into the output, and generated again whenever they are needed.
+   * This is not a limit on the process as a whole, as the models may still
+   * buffer some of their geometry while generating it. 0, the default, means
+   * there is no limit.
+   *
+   * \note This is not reset by reset(): it limits what the process may use
+   *       rather than describing a job, and it never changes the output.
+   */
+  std::size_t maxMemory;
+
+  /**\brief Level of detail tolerance
+   *
+   * Parts of IFS models that, once projected, are smaller than this in
+   * both directions are not iterated any further. Sizes are in the same
+   * units as the SVG view box, which is 2.4 units wide. 0, the default,
+   * disables this, so all parts are iterated as often as the model says.
+   */
+  Q lodTolerance;
+
+  /**\brief Chaos game samples
+   *
+   * The number of samples to generate with the chaos game for point clouds
+   * and IFS raster images. If this is set, IFS models are always rendered
+   * to raster images with the chaos game, just like with fractal flame
+   * colouring. 0, the default, uses 2^20 samples for point clouds and lets
+   * raster images stop sampling once they look converged.
+   */
+  std::uint64_t samples;
+
+  /**\brief Duplicate face tolerance
+   *
+   * If set, faces whose coordinates are the same as those of an earlier
+   * face, once rounded to multiples of this, are removed before the faces
+   * are written out. The number of faces that were removed is added to the
+   * statistics, which the stats option reports. 0, the default, keeps all
+   * faces.
+   */
+  Q duplicateTolerance;
+
+  /**\brief Project vertices in single precision?
+   *
+   * If set, batches of vertices are projected as floats, with matrices that
+   * are still composed in the state's precision. That halves the memory
+   * that the batches need, and vectorised code can handle twice as many
+   * vertices at once. Has no effect if the state already uses floats.
+   */
+  bool floatVertices;
+
+  /**\brief Performance statistics
+   *
+   * Time spent in each phase of processing this state object, along with
+   * the size of the generated geometry and output. Mutable, as rendering
+   * records statistics even though it doesn't otherwise modify the state.
+   * These accumulate over all the jobs rendered with this state object, so
+   * they are not reset by reset().
+   */
+  mutable stats statistics;
 };
 
 /**\brief Gather model metadata
@@ -1019,6 +1389,9 @@ template <typename C, typename Q, std::size_t d>
     }
   }
   stream.stream << "/>";
+  if (pState.orthographic) {
+    stream.stream << "<t:projection mode='orthographic' depth='" << d << "'/>";
+  }
 
   return operator<< <C, Q, d - 1>(stream, pState);
 }
@@ -1061,6 +1434,11 @@ template <typename C, typename Q, std::size_t d>
       << "'/>"
       << "<t:flame coefficients='" << pState.parameter.flameCoefficients
       << "'/>"
+      << "<t:raster width='" << pState.rasterWidth << "' height='"
+      << pState.rasterHeight << "'/>"
+      << "<t:lod tolerance='" << double(pState.lodTolerance) << "'/>"
+      << "<t:chaos samples='" << pState.samples << "'/>"
+      << "<t:dedup tolerance='" << double(pState.duplicateTolerance) << "'/>"
       << "<t:colour-background red='" << double(pState.background.red)
       << "' green='" << double(pState.background.green) << "' blue='"
       << double(pState.background.blue) << "' alpha='"
@@ -1073,6 +1451,9 @@ template <typename C, typename Q, std::size_t d>
       << double(pState.surface.green) << "' blue='"
       << double(pState.surface.blue) << "' alpha='"
       << double(pState.surface.alpha) << "'/>";
+  if (pState.statistics.enabled && pState.statistics.metadata) {
+    pState.statistics.xml(stream.stream);
+  }
 
   return stream;
 }
@@ -0,0 +1,278 @@
+/**\file
+ * \brief Performance statistics
+ *
+ * When a render is slow, the first question is which part of it is slow. The
+ * class in this file keeps track of how much time is spent in each phase of
+ * a run, along with a few other numbers that help answer that question, and
+ * reports them as JSON or as an XML metadata fragment.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_STATS_H)
+#define TOPOLOGIC_STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <time.h>
+
+namespace topologic {
+/**\brief Performance statistics
+ *
+ * Accumulates the wall clock and CPU time spent in named phases, the number
+ * of faces and vertices generated, the number of duplicate faces removed
+ * and the number of bytes of output. Times
+ * are always recorded, as that's cheap enough; 'enabled' only decides
+ * whether they're reported.
+ */
+class stats {
+public:
+  /**\brief Time spent in a phase */
+  class phase {
+  public:
+    /**\brief Name of the phase */
+    std::string name;
+
+    /**\brief Wall clock time, in seconds */
+    double wall;
+
+    /**\brief CPU time of the whole process, in seconds */
+    double cpu;
+
+    /**\brief Number of times the phase was entered */
+    std::size_t count;
+  };
+
+  /**\brief Default constructor
+   *
+   * Starts with no recorded phases and reporting disabled.
+   */
+  stats(void)
+      : enabled(false), metadata(false), faces(0), vertices(0),
+        duplicates(0), bytes(0) {}
+
+  /**\brief Time phase
+   *
+   * Runs the given function and adds the time it took to the named phase.
+   *
+   * \tparam F Function type; called without arguments.
+   *
+   * \param[in] name Name of the phase.
+   * \param[in] f    The function to run.
+   */
+  template <typename F> void time(const std::string &name, F f) {
+    const double w = wall(), c = cpu();
+    f();
+    add(name, wall() - w, cpu() - c);
+  }
+
+  /**\brief Add time to phase
+   *
+   * \param[in] name  Name of the phase.
+   * \param[in] pWall Wall clock time to add, in seconds.
+   * \param[in] pCPU  CPU time to add, in seconds.
+   */
+  void add(const std::string &name, double pWall, double pCPU) {
+    for (auto &p : phases) {
+      if (p.name == name) {
+        p.wall += pWall;
+        p.cpu += pCPU;
+        p.count++;
+        return;
+      }
+    }
+    phases.push_back(phase{name, pWall, pCPU, 1});
+  }
+
+  /**\brief Add statistics
+   *
+   * Adds the phases and counters of another set of statistics to these,
+   * e.g. to combine the statistics of several worker threads. Times are
+   * added up, so phases that ran in parallel can take more wall clock time
+   * than actually passed.
+   *
+   * \param[in] s The statistics to add.
+   */
+  void merge(const stats &s) {
+    for (const auto &q : s.phases) {
+      bool found = false;
+      for (auto &p : phases) {
+        if (p.name == q.name) {
+          p.wall += q.wall;
+          p.cpu += q.cpu;
+          p.count += q.count;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        phases.push_back(q);
+      }
+    }
+    faces += s.faces;
+    vertices += s.vertices;
+    duplicates += s.duplicates;
+    bytes += s.bytes;
+  }
+
+  /**\brief Discard statistics
+   *
+   * Forgets all of the phases and counters, but keeps the settings that
+   * decide whether and where they're reported.
+   */
+  void clear(void) {
+    phases.clear();
+    faces = 0;
+    vertices = 0;
+    duplicates = 0;
+    bytes = 0;
+  }
+
+  /**\brief Current wall clock time, in seconds */
+  static double wall(void) {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**\brief CPU time used by the process so far, in seconds */
+  static double cpu(void) {
+    struct timespec t;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t) != 0) {
+      return 0.;
+    }
+    return double(t.tv_sec) + double(t.tv_nsec) * 1e-9;
+  }
+
+  /**\brief Peak resident set size of the process, in bytes */
+  static std::size_t peakRSS(void) {
+    struct rusage u;
+    if (getrusage(RUSAGE_SELF, &u) != 0) {
+      return 0;
+    }
+#if defined(__APPLE__)
+    return std::size_t(u.ru_maxrss);
+#else
+    return std::size_t(u.ru_maxrss) * 1024;
+#endif
+  }
+
+  /**\brief Write JSON report
+   *
+   * \param[out] output The stream to write to.
+   *
+   * \returns The stream that was passed in.
+   */
+  std::ostream &json(std::ostream &output) const {
+    output << "{\"phases\":{";
+    for (std::size_t i = 0; i < phases.size(); i++) {
+      output << (i > 0 ? "," : "") << "\"" << phases[i].name
+             << "\":{\"wall\":" << phases[i].wall
+             << ",\"cpu\":" << phases[i].cpu
+             << ",\"count\":" << phases[i].count << "}";
+    }
+    return output << "},\"faces\":" << faces << ",\"vertices\":" << vertices
+                  << ",\"duplicates\":" << duplicates << ",\"bytes\":" << bytes
+                  << ",\"peakRSS\":" << peakRSS() << "}\n";
+  }
+
+  /**\brief Write XML metadata
+   *
+   * Writes the statistics as a t:stats element, with one t:phase element
+   * per phase. Only the phases up to the point where this is called are
+   * included, so in SVG output this is everything before the faces are
+   * generated and written.
+   *
+   * \param[out] output The stream to write to.
+   *
+   * \returns The stream that was passed in.
+   */
+  std::ostream &xml(std::ostream &output) const {
+    output << "<t:stats faces='" << faces << "' vertices='" << vertices
+           << "' duplicates='" << duplicates << "' peak-rss='" << peakRSS()
+           << "'>";
+    for (const auto &p : phases) {
+      output << "<t:phase name='" << p.name << "' wall='" << p.wall
+             << "' cpu='" << p.cpu << "' count='" << p.count << "'/>";
+    }
+    return output << "</t:stats>";
+  }
+
+  /**\brief Report statistics?
+   *
+   * Set by the "stats" option; if set, frontends report the statistics on
+   * stderr once they're done.
+   */
+  bool enabled;
+
+  /**\brief Include statistics in metadata?
+   *
+   * If set, the statistics are also written to the metadata of SVG output.
+   */
+  bool metadata;
+
+  /**\brief Phases, in the order they were first entered */
+  std::vector<phase> phases;
+
+  /**\brief Number of faces generated */
+  std::size_t faces;
+
+  /**\brief Number of vertices generated */
+  std::size_t vertices;
+
+  /**\brief Number of duplicate faces removed */
+  std::size_t duplicates;
+
+  /**\brief Number of bytes of output */
+  std::size_t bytes;
+};
+
+/**\brief Counting stream buffer
+ *
+ * Passes everything written to it on to another stream buffer, and keeps
+ * track of how many bytes that was.
+ */
+class countingBuffer : public std::streambuf {
+public:
+  /**\brief Construct with target buffer
+   *
+   * \param[in,out] pTarget The stream buffer to pass output on to.
+   */
+  countingBuffer(std::streambuf *pTarget) : bytes(0), target(pTarget) {}
+
+  /**\brief Number of bytes written so far */
+  std::size_t bytes;
+
+protected:
+  int overflow(int c) {
+    if (c == traits_type::eof()) {
+      return traits_type::not_eof(c);
+    }
+    bytes++;
+    return target->sputc(char(c));
+  }
+
+  std::streamsize xsputn(const char *s, std::streamsize n) {
+    const std::streamsize w = target->sputn(s, n);
+    bytes += std::size_t(w);
+    return w;
+  }
+
+  int sync(void) { return target->pubsync(); }
+
+  /**\brief The stream buffer that output is passed on to */
+  std::streambuf *target;
+};
+}
+
+#endif
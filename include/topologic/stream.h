@@ -0,0 +1,269 @@
+/**\file
+ * \brief Streaming output
+ *
+ * Large models produce SVGs that are hundreds of megabytes in size, and with
+ * those, most of the time is spent formatting numbers through iostreams. The
+ * sink in this file formats coordinates itself and writes them in large,
+ * fixed-size chunks, so that the memory needed for output doesn't grow with
+ * the size of the model.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#if !defined(TOPOLOGIC_STREAM_H)
+#define TOPOLOGIC_STREAM_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include <errno.h>
+#include <unistd.h>
+
+namespace topologic {
+/**\brief Buffered output sink
+ *
+ * Collects output in a fixed-size buffer and writes it out whenever the
+ * buffer is full, either straight to a file descriptor or to an output
+ * stream. Also provides a number formatter that is a lot faster than going
+ * through an iostream.
+ */
+class sink {
+public:
+  /**\brief Size of the output buffer, in bytes */
+  static const std::size_t chunk = 1 << 20;
+
+  /**\brief Construct with file descriptor
+   *
+   * \param[in] pFD The file descriptor to write to.
+   */
+  sink(int pFD) : bytes(0), fd(pFD), stream(0), size(0), good(true) {}
+
+  /**\brief Construct with output stream
+   *
+   * \param[out] pStream The stream to write to.
+   */
+  sink(std::ostream &pStream)
+      : bytes(0), fd(-1), stream(&pStream), size(0), good(true) {}
+
+  /**\brief Copy constructor
+   *
+   * Deleted, so that the same output isn't written twice.
+   */
+  sink(const sink &) = delete;
+
+  /**\brief Destructor
+   *
+   * Writes out anything that is still in the buffer.
+   */
+  ~sink(void) { flush(); }
+
+  /**\brief Append string
+   *
+   * \param[in] s The string to append.
+   *
+   * \returns A reference to this object.
+   */
+  sink &operator<<(const std::string &s) { return append(s.data(), s.size()); }
+
+  /**\brief Append C string
+   *
+   * \param[in] s The 0-terminated string to append.
+   *
+   * \returns A reference to this object.
+   */
+  sink &operator<<(const char *s) { return append(s, std::strlen(s)); }
+
+  /**\brief Append raw data
+   *
+   * \param[in] data   The data to append.
+   * \param[in] length Number of bytes to append.
+   *
+   * \returns A reference to this object.
+   */
+  sink &append(const char *data, std::size_t length) {
+    bytes += length;
+    while (length > 0) {
+      if (size == chunk) {
+        flush();
+      }
+      std::size_t n = std::min(length, chunk - size);
+      std::memcpy(buffer + size, data, n);
+      size += n;
+      data += n;
+      length -= n;
+    }
+    return *this;
+  }
+
+  /**\brief Format number
+   *
+   * Writes the given value to the given buffer with up to six decimal
+   * places, omitting trailing zeroes. This is accurate to well below the
+   * size of a pixel in the coordinate ranges that topologic produces, and
+   * much cheaper than a general-purpose conversion. Values that are too
+   * large for the fast path are formatted with snprintf() instead.
+   *
+   * \param[out] out   Where to write to; must have room for 32 bytes.
+   * \param[in]  value The value to format.
+   *
+   * \returns The number of bytes written, not including a terminating 0,
+   *          which is not written.
+   */
+  static std::size_t format(char *out, double value) {
+    if (!(std::fabs(value) < 1e12)) {
+      return std::snprintf(out, 32, "%g", value);
+    }
+
+    char *p = out;
+    std::int64_t v = std::llround(value * 1e6);
+    if (v < 0) {
+      *p++ = '-';
+      v = -v;
+    }
+
+    std::uint64_t integral = std::uint64_t(v) / 1000000;
+    std::uint64_t fraction = std::uint64_t(v) % 1000000;
+
+    char digits[24];
+    std::size_t n = 0;
+    do {
+      digits[n++] = char('0' + integral % 10);
+      integral /= 10;
+    } while (integral > 0);
+    while (n > 0) {
+      *p++ = digits[--n];
+    }
+
+    if (fraction > 0) {
+      std::size_t places = 6;
+      while (fraction % 10 == 0) {
+        fraction /= 10;
+        places--;
+      }
+      *p++ = '.';
+      for (std::size_t i = places; i > 0; i--) {
+        p[i - 1] = char('0' + fraction % 10);
+        fraction /= 10;
+      }
+      p += places;
+    }
+
+    if ((p - out == 2) && (out[0] == '-') && (out[1] == '0')) {
+      out[0] = '0';
+      return 1;
+    }
+
+    return p - out;
+  }
+
+  /**\brief Append SVG path
+   *
+   * Appends a closed SVG path element for the given, already projected
+   * face. Like topologic::path(), each point after the first is written in
+   * absolute or relative form, whichever is shorter.
+   *
+   * \tparam V Vector type of the vertices.
+   * \tparam f Number of vertices in the face.
+   *
+   * \param[in] v The vertices of the face.
+   *
+   * \returns A reference to this object.
+   */
+  template <typename V, std::size_t f>
+  sink &path(const std::array<V, f> &v) {
+    char abs[66], rel[66];
+    std::size_t a = point(abs, double(v[0][0]), double(v[0][1]));
+
+    append("<path d='M", 10).append(abs, a);
+
+    for (std::size_t i = 1; i < f; i++) {
+      a = point(abs, double(v[i][0]), double(v[i][1]));
+      std::size_t r = point(rel, double(v[i][0] - v[i - 1][0]),
+                            double(v[i][1] - v[i - 1][1]));
+      if (r < a) {
+        append("l", 1).append(rel, r);
+      } else {
+        append("L", 1).append(abs, a);
+      }
+    }
+
+    return append("Z'/>", 4);
+  }
+
+  /**\brief Write buffer
+   *
+   * Writes everything in the buffer to the file descriptor or stream.
+   *
+   * \returns 'true' if all output so far has been written successfully.
+   */
+  bool flush(void) {
+    if (stream) {
+      stream->write(buffer, size);
+      good = good && bool(*stream);
+    } else {
+      const char *p = buffer;
+      std::size_t n = size;
+      while (good && (n > 0)) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+          good = (errno == EINTR);
+          continue;
+        }
+        p += w;
+        n -= w;
+      }
+    }
+    size = 0;
+    return good;
+  }
+
+  /**\brief Number of bytes appended so far */
+  std::size_t bytes;
+
+protected:
+  /**\brief Format point
+   *
+   * Writes a pair of coordinates, separated by a comma.
+   *
+   * \param[out] out Where to write to; must have room for 66 bytes.
+   * \param[in]  x   The first coordinate.
+   * \param[in]  y   The second coordinate.
+   *
+   * \returns The number of bytes written.
+   */
+  static std::size_t point(char *out, double x, double y) {
+    std::size_t n = format(out, x);
+    out[n++] = ',';
+    return n + format(out + n, y);
+  }
+
+  /**\brief File descriptor to write to, if there's no stream */
+  int fd;
+
+  /**\brief Stream to write to; 0 to write to the file descriptor */
+  std::ostream *stream;
+
+  /**\brief Output buffer */
+  char buffer[chunk];
+
+  /**\brief Number of bytes in the buffer */
+  std::size_t size;
+
+  /**\brief Have all writes succeeded so far? */
+  bool good;
+};
+}
+
+#endif
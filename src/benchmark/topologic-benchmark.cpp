@@ -0,0 +1,42 @@
+/**\ingroup topologic-frontend
+ * \defgroup frontend-benchmark Benchmark harness
+ * \brief Benchmarks for the rendering pipeline
+ *
+ * Times model construction, matrix updates and serialisation for all the
+ * supported models, to catch performance regressions.
+ *
+ * \{
+ */
+
+/**\file
+ * \brief Topologic benchmark harness
+ *
+ * Command line programme that runs topologic's benchmarks and writes the
+ * results to stdout, as JSON. Use "make benchmark" to build and run it.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/benchmark.h>
+
+/**\brief Benchmark main function
+ *
+ * This is really just a stub that calls the topologic::benchmarks function,
+ * which contains the actual logic for the benchmark harness.
+ *
+ * \param[in] argc The number of arguments in the argv array.
+ * \param[in] argv The actual command line arguments passed to the programme.
+ *
+ * \returns 0 on success, nonzero otherwise.
+ */
+int main(int argc, char *argv[]) {
+  return topologic::benchmarks<double>(argc, argv);
+}
+
+/** \} */
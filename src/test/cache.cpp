@@ -0,0 +1,148 @@
+/**\file
+ * \brief Tests for the on-disk geometry cache
+ *
+ * Stores geometry with topologic::cache::store() in a temporary directory
+ * and checks that topologic::cache::load() gets exactly the same scalars
+ * back, and that it treats files that don't match the key or the layout as
+ * cache misses.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/cache.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+/**\brief Load scalars
+ *
+ * \tparam Q Base data type for calculations.
+ *
+ * \param[in]  directory    The cache directory.
+ * \param[in]  key          The cache key.
+ * \param[in]  dimensions   Number of dimensions per vertex.
+ * \param[in]  faceVertices Number of vertices per face.
+ * \param[out] data         The scalars that were loaded.
+ *
+ * \returns 'true' on a cache hit.
+ */
+template <typename Q>
+static bool load(const std::string &directory, const std::string &key,
+                 std::size_t dimensions, std::size_t faceVertices,
+                 std::vector<Q> &data) {
+  return topologic::cache::load<Q>(
+      directory, key, dimensions, faceVertices,
+      [&](const Q *d, std::size_t faces) {
+        data.assign(d, d + faces * dimensions * faceVertices);
+      });
+}
+
+/**\brief Read file
+ *
+ * \param[in] name The file to read.
+ *
+ * \returns The contents of the file.
+ */
+static std::string read(const std::string &name) {
+  std::ifstream in(name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+/**\brief Write file
+ *
+ * \param[in] name     The file to write.
+ * \param[in] contents What to write to the file.
+ */
+static void write(const std::string &name, const std::string &contents) {
+  std::ofstream out(name, std::ios::binary);
+  out << contents;
+}
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  using namespace topologic;
+  bool ok = true;
+
+  char base[] = "/tmp/topologic-cache-test.XXXXXX";
+  if (mkdtemp(base) == 0) {
+    std::cerr << "error: could not create a temporary directory\n";
+    return 1;
+  }
+  const std::string directory = std::string(base) + "/a/b";
+  const std::string key = "topologic/test 64-bit cube 3 4";
+
+  std::vector<double> data;
+  for (std::size_t i = 0; i < 2 * 4 * 3; i++) {
+    data.push_back(double(i) / 7. - 1.);
+  }
+
+  if (!cache::store(directory, key, 3, 4, data, 1 << 20)) {
+    std::cerr << "error: could not store geometry in a new directory\n";
+    ok = false;
+  }
+
+  const std::string name = cache::file(directory, key);
+  const std::string contents = read(name);
+  cache::header h;
+  std::memcpy(&h, contents.data(), std::min(sizeof(h), contents.size()));
+  if ((contents.size() < sizeof(h)) || (h.faces != 2) ||
+      (h.dataOffset % 64 != 0) || (h.keyLength != key.size()) ||
+      (contents.size() != h.dataOffset + data.size() * sizeof(double))) {
+    std::cerr << "error: unexpected cache file layout\n";
+    ok = false;
+  }
+
+  std::vector<double> back;
+  if (!load(directory, key, 3, 4, back) || (back != data)) {
+    std::cerr << "error: geometry didn't survive the round trip\n";
+    ok = false;
+  }
+
+  std::vector<float> single;
+  if (load(directory, key, 3, 4, single)) {
+    std::cerr << "error: loaded doubles as floats\n";
+    ok = false;
+  }
+  if (load(directory, key, 4, 3, back) || load(directory, key, 3, 3, back)) {
+    std::cerr << "error: loaded geometry with the wrong layout\n";
+    ok = false;
+  }
+
+  std::string other = key;
+  other[other.size() - 1] = '5';
+  write(cache::file(directory, other), contents);
+  if (load(directory, other, 3, 4, back)) {
+    std::cerr << "error: loaded geometry for a different key\n";
+    ok = false;
+  }
+
+  write(name, contents.substr(0, contents.size() - 1));
+  if (load(directory, key, 3, 4, back)) {
+    std::cerr << "error: loaded a truncated file\n";
+    ok = false;
+  }
+
+  if (cache::store(directory, key, 3, 4, data, 64)) {
+    std::cerr << "error: stored a file larger than the budget\n";
+    ok = false;
+  }
+
+  std::remove(name.c_str());
+  std::remove(cache::file(directory, other).c_str());
+  rmdir(directory.c_str());
+  rmdir((std::string(base) + "/a").c_str());
+  rmdir(base);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+/**\file
+ * \brief Tests for duplicate face removal
+ *
+ * Checks that topologic::dedup recognises faces that only differ in where
+ * they start or in their winding, and that it keeps faces that really are
+ * different.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/dedup.h>
+#include <iostream>
+#include <limits>
+
+/**\brief Filter type used in these tests: triangles in 3-space */
+using filter = topologic::dedup<double, 3, 3>;
+
+/**\brief Create face
+ *
+ * \param[in] c The coordinates of the three vertices, one after the other.
+ *
+ * \returns A face with the given vertices.
+ */
+static filter::face triangle(const std::array<double, 9> &c) {
+  filter::face g;
+  for (std::size_t v = 0; v < 3; v++) {
+    for (std::size_t i = 0; i < 3; i++) {
+      g[v][i] = c[v * 3 + i];
+    }
+  }
+  return g;
+}
+
+/**\brief Compare faces
+ *
+ * \param[in] a The first face.
+ * \param[in] b The second face.
+ *
+ * \returns 'true' if all the coordinates of both faces are the same.
+ */
+static bool same(const filter::face &a, const filter::face &b) {
+  for (std::size_t v = 0; v < 3; v++) {
+    for (std::size_t i = 0; i < 3; i++) {
+      if (a[v][i] != b[v][i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**\brief Check insert result
+ *
+ * \param[in,out] d        The filter to add the face to.
+ * \param[in]     g        The face to add.
+ * \param[in]     expected Whether the face should be new.
+ * \param[in]     what     Description of the face, for error messages.
+ *
+ * \returns 'true' if the filter did what was expected.
+ */
+static bool insert(filter &d, const filter::face &g, bool expected,
+                   const char *what) {
+  if (d.insert(g) != expected) {
+    std::cerr << "error: " << what << " was "
+              << (expected ? "a duplicate" : "not a duplicate") << "\n";
+    return false;
+  }
+  return true;
+}
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  bool ok = true;
+  filter d(0.001);
+
+  const filter::face a = triangle({{0, 0, 0, 1, 0, 0, 0, 1, 0}});
+  ok = insert(d, a, true, "first face") && ok;
+  ok = insert(d, a, false, "same face") && ok;
+  ok = insert(d, triangle({{1, 0, 0, 0, 1, 0, 0, 0, 0}}), false,
+              "rotated face") && ok;
+  ok = insert(d, triangle({{0, 1, 0, 1, 0, 0, 0, 0, 0}}), false,
+              "reversed face") && ok;
+  ok = insert(d, triangle({{1, 0, 0, 0, 0, 0, 0, 1, 0}}), false,
+              "rotated and reversed face") && ok;
+  ok = insert(d, triangle({{0.0001, 0, 0, 1, 0, 0, 0, 1, 0.0001}}), false,
+              "face within tolerance") && ok;
+  ok = insert(d, triangle({{0, 0, 0, 1, 0, 0, 0, 0, 1}}), true,
+              "different face") && ok;
+  ok = insert(d, triangle({{0, 0, 0, 1, 0, 0, 0, 1.01, 0}}), true,
+              "face outside tolerance") && ok;
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const filter::face n = triangle({{nan, 0, 0, 1, 0, 0, 0, 1, 0}});
+  ok = insert(d, n, true, "first face with a NaN") && ok;
+  ok = insert(d, n, true, "second face with a NaN") && ok;
+
+  if (d.removed != 5) {
+    std::cerr << "error: counted " << d.removed
+              << " duplicates instead of 5\n";
+    ok = false;
+  }
+
+  filter e(0.001);
+  const filter::face b = triangle({{0, 0, 0, 0, 0, 1, 1, 0, 0}});
+  const filter::face c = triangle({{0, 1, 0, 0, 0, 0, 1, 0, 0}});
+  std::vector<filter::face> faces = {a, b, c, a};
+  e.filter(faces);
+  if ((faces.size() != 2) || !same(faces[0], a) || !same(faces[1], b)) {
+    std::cerr << "error: filter() kept " << faces.size()
+              << " faces instead of the first two\n";
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
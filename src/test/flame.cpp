@@ -0,0 +1,191 @@
+/**\file
+ * \brief Tests for the chaos game's random numbers
+ *
+ * Checks that topologic::flame::random produces the SplitMix64 sequence,
+ * that its streams only depend on their key, and that its real numbers
+ * stay in [0,1).
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/flame.h>
+#include <iostream>
+#include <sstream>
+
+/**\brief Affine map of the plane */
+struct affine {
+  /**\brief Scale */
+  double s;
+
+  /**\brief Translation */
+  double x, y;
+
+  /**\brief Apply map
+   *
+   * \param[in] v The vector to map.
+   *
+   * \returns The mapped vector.
+   */
+  efgy::math::vector<double, 2>
+  operator*(const efgy::math::vector<double, 2> &v) const {
+    efgy::math::vector<double, 2> r;
+    r[0] = s * v[0] + x;
+    r[1] = s * v[1] + y;
+    return r;
+  }
+};
+
+/**\brief Chaos game samples, by chunk */
+using chunks = std::vector<std::vector<std::array<double, 3>>>;
+
+/**\brief Play the chaos game
+ *
+ * \param[in]  threads Number of threads to use.
+ * \param[out] used    Set to the number of threads that generated samples.
+ *
+ * \returns The samples of each chunk, in the order they were generated.
+ */
+static chunks play(std::size_t threads, std::size_t &used) {
+  const std::vector<affine> functions = {
+      {.5, 0., 0.}, {.5, .5, 0.}, {.5, .25, .5}};
+  const std::size_t count = 32;
+  chunks c(count);
+  std::vector<std::atomic<bool>> workers(64);
+
+  topologic::flame::play<double, 2>(
+      functions, 7, 5, count, 1000, threads,
+      [&](std::size_t worker, std::size_t chunk,
+          const efgy::math::vector<double, 2> &p, double colour) {
+        workers[worker % workers.size()] = true;
+        c[chunk - 5].push_back({{p[0], p[1], colour}});
+      });
+
+  used = 0;
+  for (const auto &w : workers) {
+    used += w ? 1 : 0;
+  }
+  return c;
+}
+
+/**\brief Render fractal flame
+ *
+ * \param[in] threads Number of threads to use.
+ *
+ * \returns The rendered image, as a PNG.
+ */
+static std::string render(std::size_t threads) {
+  const std::vector<affine> functions = {
+      {.5, 0., 0.}, {.5, .5, 0.}, {.5, .25, .5}};
+  topologic::framebuffer image(64, 64, {{1.f, 1.f, 1.f, 1.f}});
+
+  topologic::flame::render<double, 2>(
+      image, functions,
+      [](const efgy::math::vector<double, 2> &p, double &x, double &y) {
+        x = p[0] * 64.;
+        y = p[1] * 64.;
+      },
+      7, {{0.f, 0.f, 0.f, 1.f}}, {{1.f, 0.f, 0.f, 1.f}}, 8 << 16, threads);
+
+  std::ostringstream png;
+  image.png(png);
+  return png.str();
+}
+
+/**\brief Model type without functions */
+struct plain {};
+
+/**\brief Model type with functions, like an IFS */
+struct ifs {
+  /**\brief The functions of the system */
+  std::vector<int> functions;
+};
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  using topologic::flame::random;
+  bool ok = true;
+
+  random r(0);
+  const std::uint64_t expected[] = {0xe220a8397b1dcdafull,
+                                    0x6e789e6aa1b965f4ull,
+                                    0x06c45d188009454full};
+  for (const std::uint64_t &e : expected) {
+    const std::uint64_t v = r();
+    if (v != e) {
+      std::cerr << "error: got " << std::hex << v << " instead of " << e
+                << std::dec << " from SplitMix64 with seed 0\n";
+      ok = false;
+    }
+  }
+
+  if (random::mix(0) != 0) {
+    std::cerr << "error: mix(0) is not 0\n";
+    ok = false;
+  }
+
+  random a(42), b(42), c(43), i(42);
+  bool differ = false;
+  double sum = 0.;
+  const std::size_t samples = 100000;
+  for (std::size_t n = 0; n < samples; n++) {
+    const std::uint64_t x = a(), y = b();
+    if (x != y) {
+      std::cerr << "error: streams with the same key differ\n";
+      ok = false;
+      break;
+    }
+    differ = differ || (x != c());
+
+    const double v = i.real();
+    if (!(v >= 0.) || !(v < 1.) ||
+        (v != double(x >> 11) / 9007199254740992.)) {
+      std::cerr << "error: real() returned " << v << "\n";
+      ok = false;
+      break;
+    }
+    sum += v;
+  }
+
+  if (!differ) {
+    std::cerr << "error: streams with different keys are the same\n";
+    ok = false;
+  }
+  if ((sum / samples < 0.49) || (sum / samples > 0.51)) {
+    std::cerr << "error: mean of real() is " << sum / samples << "\n";
+    ok = false;
+  }
+
+  std::size_t one, all, some;
+  const chunks serial = play(1, one);
+  if ((play(0, all) != serial) || (play(3, some) != serial)) {
+    std::cerr << "error: samples depend on the number of threads\n";
+    ok = false;
+  }
+  if ((std::thread::hardware_concurrency() > 1) && (all < 2)) {
+    std::cerr << "error: a thread count of 0 only used " << all
+              << " thread\n";
+    ok = false;
+  }
+
+  if ((render(3) != render(1)) || (render(8) != render(1))) {
+    std::cerr << "error: fractal flame depends on the number of threads\n";
+    ok = false;
+  }
+
+  if (topologic::flame::isIFS<plain>::value ||
+      !topologic::flame::isIFS<ifs>::value) {
+    std::cerr << "error: isIFS doesn't tell models apart\n";
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/**\file
+ * \brief Tests for the parallel IFS expansion
+ *
+ * Checks that topologic::ifs::detect() recognises both expansion orders and
+ * that topologic::ifs::expand() produces exactly the same faces, in the
+ * same order, as a serial expansion, no matter how many threads it uses.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/ifs.h>
+#include <iostream>
+
+/**\brief Vertex type used in these tests */
+using vertex = efgy::math::vector<double, 2>;
+
+/**\brief Face type used in these tests */
+using face = std::array<vertex, 3>;
+
+/**\brief Affine map of the plane */
+struct affine {
+  /**\brief Linear part, row by row */
+  double a, b, c, d;
+
+  /**\brief Translation */
+  double x, y;
+
+  /**\brief Apply map
+   *
+   * \param[in] v The vertex to map.
+   *
+   * \returns The mapped vertex.
+   */
+  vertex operator*(const vertex &v) const {
+    vertex r;
+    r[0] = a * v[0] + b * v[1] + x;
+    r[1] = c * v[0] + d * v[1] + y;
+    return r;
+  }
+};
+
+/**\brief Expand serially
+ *
+ * Applies the functions the way a model would, one face at a time.
+ *
+ * \param[in] base       The faces after zero iterations.
+ * \param[in] functions  The IFS functions.
+ * \param[in] iterations Number of iterations.
+ * \param[in] o          The order to put the results in.
+ *
+ * \returns The faces after the given number of iterations.
+ */
+static std::vector<face> serial(const std::vector<face> &base,
+                                const std::vector<affine> &functions,
+                                std::size_t iterations,
+                                topologic::ifs::order o) {
+  std::vector<face> in = base, out;
+  for (std::size_t i = 0; i < iterations; i++) {
+    out.clear();
+    const std::size_t outer =
+        o == topologic::ifs::functionMajor ? functions.size() : in.size();
+    const std::size_t inner =
+        o == topologic::ifs::functionMajor ? in.size() : functions.size();
+    for (std::size_t p = 0; p < outer; p++) {
+      for (std::size_t q = 0; q < inner; q++) {
+        const affine &fn =
+            functions[o == topologic::ifs::functionMajor ? p : q];
+        const face &g = in[o == topologic::ifs::functionMajor ? q : p];
+        out.push_back({{fn * g[0], fn * g[1], fn * g[2]}});
+      }
+    }
+    in.swap(out);
+  }
+  return in;
+}
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  using namespace topologic::ifs;
+  bool ok = true;
+
+  const std::vector<affine> functions = {{.5, 0., 0., .5, 0., 0.},
+                                         {.5, .1, -.1, .5, .5, 0.},
+                                         {.4, 0., .2, .4, .25, .5}};
+  std::vector<face> base(2);
+  base[0][1][0] = 1.;
+  base[0][2][1] = 1.;
+  base[1][0][0] = 1.;
+  base[1][1][0] = 1.;
+  base[1][1][1] = 1.;
+  base[1][2][1] = 1.;
+
+  const std::size_t iterations = 9;
+
+  for (order o : {functionMajor, faceMajor}) {
+    const char *name = o == functionMajor ? "function-major" : "face-major";
+    const std::vector<face> one = serial(base, functions, 1, o),
+                            two = serial(base, functions, 2, o),
+                            all = serial(base, functions, iterations, o);
+
+    order d = o == functionMajor ? faceMajor : functionMajor;
+    if (!detect(base, one, two, functions, d) || (d != o)) {
+      std::cerr << "error: " << name << " order not detected\n";
+      ok = false;
+    }
+
+    for (std::size_t threads : {1, 4}) {
+      std::vector<face> faces;
+      if (!expand(faces, base, one, two, functions, iterations, 0, threads) ||
+          !same(faces, all)) {
+        std::cerr << "error: " << name << " expansion with " << threads
+                  << " threads differs from the serial one\n";
+        ok = false;
+      }
+    }
+
+    std::vector<face> faces;
+    if (expand(faces, base, one, two, functions, iterations,
+               sizeof(face) * all.size(), 2)) {
+      std::cerr << "error: " << name << " expansion ignored the budget\n";
+      ok = false;
+    }
+  }
+
+  std::vector<face> one = serial(base, functions, 1, functionMajor),
+                    two = serial(base, functions, 2, functionMajor);
+  std::swap(two[0], two[1]);
+  order d;
+  if (detect(base, one, two, functions, d)) {
+    std::cerr << "error: detected an order for shuffled faces\n";
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/**\file
+ * \brief Tests for reading back written settings
+ *
+ * Writes a state object's settings as command line arguments, as JSON and as
+ * SVG metadata, reads each of them back into a new state object and checks
+ * that the raster size, level of detail tolerance, chaos game sample count
+ * and duplicate face tolerance are the same as before.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/arguments.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**\brief State type used by the tests */
+typedef topologic::state<double, 4> state;
+
+/**\brief Compare settings
+ *
+ * \param[in] source   Where the settings were read from.
+ * \param[in] got      The state object the settings were read into.
+ * \param[in] expected The state object the settings were written from.
+ *
+ * \returns 'true' if the settings that were read are the same as the ones
+ *          that were written.
+ */
+static bool same(const std::string &source, const state &got,
+                 const state &expected) {
+  bool ok = true;
+
+  if ((got.rasterWidth != expected.rasterWidth) ||
+      (got.rasterHeight != expected.rasterHeight)) {
+    std::cerr << "error: read raster size " << got.rasterWidth << "x"
+              << got.rasterHeight << " from " << source << " instead of "
+              << expected.rasterWidth << "x" << expected.rasterHeight << "\n";
+    ok = false;
+  }
+  if (got.lodTolerance != expected.lodTolerance) {
+    std::cerr << "error: read level of detail tolerance " << got.lodTolerance
+              << " from " << source << " instead of " << expected.lodTolerance
+              << "\n";
+    ok = false;
+  }
+  if (got.samples != expected.samples) {
+    std::cerr << "error: read " << got.samples << " samples from " << source
+              << " instead of " << expected.samples << "\n";
+    ok = false;
+  }
+  if (got.duplicateTolerance != expected.duplicateTolerance) {
+    std::cerr << "error: read duplicate tolerance " << got.duplicateTolerance
+              << " from " << source << " instead of "
+              << expected.duplicateTolerance << "\n";
+    ok = false;
+  }
+
+  return ok;
+}
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  bool ok = true;
+  state written;
+  topologic::arguments<double, 4> options(written);
+
+  std::vector<std::string> defaults = {"topologic"};
+  written.args(defaults);
+  for (const auto &arg : defaults) {
+    if ((arg.find("lod:") == 0) || (arg.find("samples:") == 0) ||
+        (arg.find("dedup:") == 0) || (arg.find("size:") == 0)) {
+      std::cerr << "error: wrote default setting as '" << arg << "'\n";
+      ok = false;
+    }
+  }
+
+  options.apply({"topologic", "m:3-cube", "lod:2.5e-05", "samples:5000",
+                 "dedup:0.001", "size:320x200"});
+  if (!written.model) {
+    std::cerr << "error: no model to write the settings of\n";
+    return 1;
+  }
+
+  std::vector<std::string> args = {"topologic"};
+  written.args(args);
+  state fromArguments;
+  options.bind(fromArguments);
+  options.apply(args, false);
+  ok = same("arguments", fromArguments, written) && ok;
+
+  std::ostringstream json;
+  json << efgy::json::tag() << written;
+  state fromJSON;
+  options.bind(fromJSON);
+  if (!options.loadJSON(json.str())) {
+    std::cerr << "error: could not read back JSON: " << json.str() << "\n";
+    ok = false;
+  }
+  ok = same("JSON", fromJSON, written) && ok;
+
+#if !defined(NOLIBRARIES)
+  std::ostringstream svg;
+  svg << efgy::svg::tag() << written;
+  state fromSVG;
+  options.bind(fromSVG);
+  if (!options.load(svg.str(), "metadata.svg")) {
+    std::cerr << "error: could not read back SVG metadata\n";
+    ok = false;
+  }
+  ok = same("SVG metadata", fromSVG, written) && ok;
+#endif
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+/**\file
+ * \brief Tests for the PNG writer
+ *
+ * Writes PNG images with topologic::framebuffer and checks the CRC-32 of
+ * each chunk and the Adler-32 of the image data against straightforward,
+ * bit-by-bit implementations of both checksums.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/raster.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**\brief Read 32-bit big-endian integer
+ *
+ * \param[in] s The string to read from.
+ * \param[in] i Offset of the integer in the string.
+ *
+ * \returns The integer at the given offset.
+ */
+static std::uint32_t bigEndian(const std::string &s, std::size_t i) {
+  return (std::uint32_t((unsigned char)s[i]) << 24) |
+         (std::uint32_t((unsigned char)s[i + 1]) << 16) |
+         (std::uint32_t((unsigned char)s[i + 2]) << 8) |
+         std::uint32_t((unsigned char)s[i + 3]);
+}
+
+/**\brief Calculate CRC-32, one bit at a time
+ *
+ * \param[in] s The data to checksum.
+ *
+ * \returns The CRC-32 of the data, as used by PNG.
+ */
+static std::uint32_t crc32(const std::string &s) {
+  std::uint32_t c = 0xffffffffu;
+  for (const char &b : s) {
+    c ^= (unsigned char)b;
+    for (std::size_t k = 0; k < 8; k++) {
+      c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+    }
+  }
+  return c ^ 0xffffffffu;
+}
+
+/**\brief Calculate Adler-32, reducing after every byte
+ *
+ * \param[in] s The data to checksum.
+ *
+ * \returns The Adler-32 of the data, as used by zlib.
+ */
+static std::uint32_t adler32(const std::string &s) {
+  std::uint32_t a = 1, b = 0;
+  for (const char &c : s) {
+    a = (a + (unsigned char)c) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+/**\brief Check PNG image
+ *
+ * Goes through the chunks of the given PNG image, checking their CRCs, and
+ * unpacks the stored deflate blocks of the image data to check its
+ * Adler-32.
+ *
+ * \param[in] png    The image to check.
+ * \param[in] width  The width that the image should have.
+ * \param[in] height The height that the image should have.
+ *
+ * \returns 'true' if the image is valid.
+ */
+static bool check(const std::string &png, std::size_t width,
+                  std::size_t height) {
+  if (png.compare(0, 8, "\x89PNG\r\n\x1a\n") != 0) {
+    std::cerr << "error: PNG signature missing\n";
+    return false;
+  }
+
+  std::string types, data;
+  for (std::size_t i = 8; i + 12 <= png.size();) {
+    const std::size_t n = bigEndian(png, i);
+    if (i + 12 + n > png.size()) {
+      std::cerr << "error: truncated chunk\n";
+      return false;
+    }
+    const std::string type = png.substr(i + 4, 4);
+    if (crc32(png.substr(i + 4, n + 4)) != bigEndian(png, i + 8 + n)) {
+      std::cerr << "error: bad CRC in " << type << " chunk\n";
+      return false;
+    }
+    if (type == "IHDR") {
+      if ((bigEndian(png, i + 8) != width) ||
+          (bigEndian(png, i + 12) != height)) {
+        std::cerr << "error: wrong image size\n";
+        return false;
+      }
+    } else if (type == "IDAT") {
+      data += png.substr(i + 8, n);
+    }
+    types += type;
+    i += 12 + n;
+  }
+
+  if (types != "IHDRIDATIEND") {
+    std::cerr << "error: unexpected chunks: " << types << "\n";
+    return false;
+  }
+
+  std::string raw;
+  std::size_t i = 2;
+  for (bool last = false; !last;) {
+    if (i + 5 > data.size()) {
+      std::cerr << "error: truncated deflate stream\n";
+      return false;
+    }
+    last = data[i] & 1;
+    const std::size_t n = (unsigned char)data[i + 1] |
+                          (std::size_t((unsigned char)data[i + 2]) << 8);
+    raw += data.substr(i + 5, n);
+    i += 5 + n;
+  }
+
+  if (raw.size() != height * (width * 4 + 1)) {
+    std::cerr << "error: " << raw.size() << " bytes of image data instead of "
+              << height * (width * 4 + 1) << "\n";
+    return false;
+  }
+  if ((i + 4 != data.size()) || (adler32(raw) != bigEndian(data, i))) {
+    std::cerr << "error: bad Adler-32\n";
+    return false;
+  }
+
+  return true;
+}
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  bool ok = true;
+
+  if (crc32("IEND") != 0xae426082u) {
+    std::cerr << "error: reference CRC-32 is broken\n";
+    ok = false;
+  }
+  if (adler32("Wikipedia") != 0x11e60398u) {
+    std::cerr << "error: reference Adler-32 is broken\n";
+    ok = false;
+  }
+
+  for (const std::size_t size : {1, 7, 64, 200}) {
+    topologic::framebuffer image(size, size + 1, {{1.f, 1.f, 1.f, 1.f}});
+    const double s = double(size);
+    image.triangle({{0., s, 0.}}, {{0., 0., s}}, {{1.f, 0.f, 0.f, .5f}});
+    image.line(0., s, s, 0., 2., {{0.f, 0.f, 1.f, 1.f}});
+    image.render(2);
+
+    std::ostringstream out;
+    if (!image.png(out)) {
+      std::cerr << "error: could not write " << size << "x" << size + 1
+                << " image\n";
+      ok = false;
+    } else if (!check(out.str(), size, size + 1)) {
+      std::cerr << "error: in " << size << "x" << size + 1 << " image\n";
+      ok = false;
+    }
+  }
+
+  return ok ? 0 : 1;
+}
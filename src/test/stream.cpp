@@ -0,0 +1,76 @@
+/**\file
+ * \brief Tests for the output sink
+ *
+ * Checks that topologic::sink::format() writes the same numbers that the
+ * SVG renderer used to write through iostreams, and that paths are written
+ * with the shorter of absolute and relative coordinates. Use "make check"
+ * to build and run this along with the other tests.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/stream.h>
+#include <iostream>
+#include <sstream>
+
+/**\brief Check formatted number
+ *
+ * \param[in] value    The value to format.
+ * \param[in] expected What sink::format() should write for it.
+ *
+ * \returns 'true' if the output was as expected.
+ */
+static bool format(double value, const std::string &expected) {
+  char buffer[32];
+  const std::string got(buffer, topologic::sink::format(buffer, value));
+
+  if (got != expected) {
+    std::cerr << "error: formatted " << value << " as '" << got
+              << "' instead of '" << expected << "'\n";
+    return false;
+  }
+  return true;
+}
+
+/**\brief Test main function
+ *
+ * \returns 0 if all the checks passed, 1 otherwise.
+ */
+int main(int, char *[]) {
+  bool ok = true;
+
+  ok = format(0., "0") && ok;
+  ok = format(-1., "-1") && ok;
+  ok = format(1.5, "1.5") && ok;
+  ok = format(0.1, "0.1") && ok;
+  ok = format(0.000001, "0.000001") && ok;
+  ok = format(-0.288675, "-0.288675") && ok;
+  ok = format(0.5773502691896258, "0.57735") && ok;
+  ok = format(2.0000004, "2") && ok;
+  ok = format(-0.0000001, "0") && ok;
+  ok = format(123456.1234564, "123456.123456") && ok;
+  ok = format(1e12, "1e+12") && ok;
+  ok = format(-3e15, "-3e+15") && ok;
+
+  std::ostringstream out;
+  topologic::sink s(out);
+  const std::array<std::array<double, 2>, 3> face = {
+      {{{0.5, -0.288675}}, {{-0.5, -0.288675}}, {{0., 0.57735}}}};
+  s.path(face);
+  s.flush();
+
+  const std::string path = "<path d='M0.5,-0.288675l-1,0L0,0.57735Z'/>";
+  if (out.str() != path) {
+    std::cerr << "error: wrote '" << out.str() << "' instead of '" << path
+              << "'\n";
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
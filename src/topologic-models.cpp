@@ -0,0 +1,48 @@
+/**\file
+ * \brief Topologic/CLI models for a single render depth
+ *
+ * When building with SPLIT_MODELS, this file is compiled once for each render
+ * depth up to MAXDEPTH, with RENDERDEPTH set to that depth, and each of the
+ * resulting objects registers the model renderers for its render depth with
+ * topologic::registry. This keeps the frontend's own translation unit small
+ * and lets the models for the different render depths compile in parallel.
+ *
+ * \copyright
+ * This file is part of the Topologic project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/topologic
+ * \see Project Source Code: https://github.com/ef-gy/topologic
+ * \see Licence Terms: https://github.com/ef-gy/topologic/blob/master/COPYING
+ */
+
+#include <topologic/cli.h>
+
+#if !defined(RENDERDEPTH)
+#error "RENDERDEPTH must be set to the render depth to build models for"
+#endif
+
+/**\brief Models for RENDERDEPTH
+ *
+ * Explicitly instantiated here, so that the models are compiled into this
+ * object file; the data types must match the ones that src/topologic.cpp
+ * can choose from.
+ */
+template class topologic::instance<double, MAXDEPTH, RENDERDEPTH>;
+#if FLOATS
+template class topologic::instance<float, MAXDEPTH, RENDERDEPTH>;
+#endif
+
+/**\brief Model registration
+ *
+ * Registers the models for RENDERDEPTH when the programme starts.
+ */
+static topologic::instance<double, MAXDEPTH, RENDERDEPTH> models;
+
+#if FLOATS
+/**\brief Model registration; floats
+ *
+ * Registers the single precision models for RENDERDEPTH.
+ */
+static topologic::instance<float, MAXDEPTH, RENDERDEPTH> floatModels;
+#endif